@@ -0,0 +1,471 @@
+//External includes
+#include "SDL.h"
+#undef main
+
+//Standard includes
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//Project includes
+#include "Math.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Texture.h"
+
+// Benchmark executable: micro benchmarks of the math and sampling code, and the raster stage and whole frames
+// of the OBJ scenes rendered headless. Results are written as JSON so runs can be compared over time.
+
+using namespace dae;
+
+namespace
+{
+	struct BenchmarkOptions
+	{
+		// only benchmarks with this in their name run
+		std::string filter{};
+		// JSON goes to stdout when empty
+		std::string outputPath{};
+		int nrSamples{ 30 };
+		int nrWarmupSamples{ 5 };
+		// micro benchmarks repeat their operation until a sample takes at least this long
+		float minSampleMs{ 5.f };
+	};
+
+	struct BenchmarkResult
+	{
+		std::string name{};
+		std::string unit{};
+		int iterationsPerSample{};
+		// time per iteration, one value per sample
+		std::vector<double> samples{};
+	};
+
+	struct SampleStatistics
+	{
+		double min{};
+		double max{};
+		double mean{};
+		double median{};
+		double stddev{};
+		double p95{};
+		// 95% confidence interval of the mean
+		double ciLow{};
+		double ciHigh{};
+	};
+
+	// Keeps the compiler from dropping a result it can see nobody uses
+	const void* volatile g_pSink{ nullptr };
+
+	template<typename T>
+	void DoNotOptimize(const T& value)
+	{
+		g_pSink = &value;
+		std::atomic_signal_fence(std::memory_order_seq_cst);
+	}
+
+	double GetElapsedMs(uint64_t startTime)
+	{
+		return static_cast<double>(SDL_GetPerformanceCounter() - startTime) * 1000.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+	}
+
+	double GetPercentile(const std::vector<double>& sorted, double percentile)
+	{
+		// linear interpolation between the closest ranks
+		const double rank{ percentile * static_cast<double>(sorted.size() - 1) };
+		const size_t lower{ static_cast<size_t>(rank) };
+		const size_t upper{ std::min(lower + 1, sorted.size() - 1) };
+		return sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - static_cast<double>(lower));
+	}
+
+	// Two sided 95% critical value of Student's t distribution
+	double GetStudentT95(size_t degreesOfFreedom)
+	{
+		static constexpr double table[]{
+			12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+			2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+			2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+		};
+
+		if (degreesOfFreedom == 0)
+			return 0.0;
+		if (degreesOfFreedom <= std::size(table))
+			return table[degreesOfFreedom - 1];
+		return 1.960;
+	}
+
+	SampleStatistics CalculateStatistics(std::vector<double> samples)
+	{
+		SampleStatistics statistics{};
+		if (samples.empty())
+			return statistics;
+
+		std::sort(samples.begin(), samples.end());
+		const double nrSamples{ static_cast<double>(samples.size()) };
+
+		statistics.min = samples.front();
+		statistics.max = samples.back();
+		statistics.median = GetPercentile(samples, 0.5);
+		statistics.p95 = GetPercentile(samples, 0.95);
+
+		for (const double sample : samples)
+			statistics.mean += sample;
+		statistics.mean /= nrSamples;
+
+		// sample standard deviation
+		if (samples.size() > 1)
+		{
+			double squaredDeviations{};
+			for (const double sample : samples)
+				squaredDeviations += (sample - statistics.mean) * (sample - statistics.mean);
+			statistics.stddev = std::sqrt(squaredDeviations / (nrSamples - 1.0));
+		}
+
+		const double margin{ GetStudentT95(samples.size() - 1) * statistics.stddev / std::sqrt(nrSamples) };
+		statistics.ciLow = statistics.mean - margin;
+		statistics.ciHigh = statistics.mean + margin;
+		return statistics;
+	}
+
+	// Runs operation(iteration) in batches: the batch size is doubled until one batch takes minSampleMs,
+	// so the timer resolution and loop overhead don't matter. Every sample is one batch, reported per iteration.
+	// The operation is a template parameter so it gets inlined into the batch loop, an indirect call per
+	// iteration would cost about as much as the ns-scale operations being measured
+	template<typename Operation>
+	BenchmarkResult RunMicroBenchmark(const std::string& name, const BenchmarkOptions& options, const Operation& operation)
+	{
+		const auto runBatch = [&operation](uint32_t nrIterations)
+		{
+			const uint64_t startTime{ SDL_GetPerformanceCounter() };
+			for (uint32_t iteration{}; iteration < nrIterations; ++iteration)
+			{
+				operation(iteration);
+			}
+			return GetElapsedMs(startTime);
+		};
+
+		uint32_t nrIterations{ 1 };
+		while (runBatch(nrIterations) < options.minSampleMs && nrIterations < (1u << 30))
+			nrIterations *= 2;
+
+		for (int sampleIdx{}; sampleIdx < options.nrWarmupSamples; ++sampleIdx)
+			runBatch(nrIterations);
+
+		BenchmarkResult result{ name, "ns", static_cast<int>(nrIterations) };
+		result.samples.reserve(options.nrSamples);
+		for (int sampleIdx{}; sampleIdx < options.nrSamples; ++sampleIdx)
+		{
+			result.samples.push_back(runBatch(nrIterations) * 1'000'000.0 / nrIterations);
+		}
+
+		return result;
+	}
+
+	bool IsSelected(const std::string& name, const BenchmarkOptions& options)
+	{
+		return options.filter.empty() || name.find(options.filter) != std::string::npos;
+	}
+
+	void RunMathBenchmarks(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results)
+	{
+		// inputs come from tables so nothing can be constant folded, sized to stay in L1
+		constexpr uint32_t nrInputs{ 256 };
+		constexpr uint32_t inputMask{ nrInputs - 1 };
+
+		std::mt19937 generator{ 1337 };
+		std::uniform_real_distribution<float> distribution{ -10.f, 10.f };
+
+		std::vector<Matrix> matrices{};
+		std::vector<Vector3> vectors{};
+		for (uint32_t inputIdx{}; inputIdx < nrInputs; ++inputIdx)
+		{
+			matrices.push_back(Matrix::CreateRotation(distribution(generator), distribution(generator), distribution(generator))
+				* Matrix::CreateTranslation(distribution(generator), distribution(generator), distribution(generator)));
+			vectors.emplace_back(distribution(generator), distribution(generator), distribution(generator));
+		}
+
+		if (IsSelected("math/matrix_multiply", options))
+		{
+			results.push_back(RunMicroBenchmark("math/matrix_multiply", options, [&](uint32_t iteration)
+				{
+					const Matrix result{ matrices[iteration & inputMask] * matrices[(iteration + 1) & inputMask] };
+					DoNotOptimize(result);
+				}));
+		}
+
+		if (IsSelected("math/transform_point", options))
+		{
+			results.push_back(RunMicroBenchmark("math/transform_point", options, [&](uint32_t iteration)
+				{
+					const Vector3 result{ matrices[(iteration >> 8) & inputMask].TransformPoint(vectors[iteration & inputMask]) };
+					DoNotOptimize(result);
+				}));
+		}
+
+		if (IsSelected("math/matrix_inverse", options))
+		{
+			results.push_back(RunMicroBenchmark("math/matrix_inverse", options, [&](uint32_t iteration)
+				{
+					const Matrix result{ Matrix::Inverse(matrices[iteration & inputMask]) };
+					DoNotOptimize(result);
+				}));
+		}
+
+		// one iteration is the whole table, compare with nrInputs times math/transform_point
+		if (IsSelected("math/transform_points", options))
+		{
+			std::vector<Vector4> transformed(nrInputs);
+			results.push_back(RunMicroBenchmark("math/transform_points", options, [&](uint32_t iteration)
+				{
+					matrices[iteration & inputMask].TransformPoints(vectors, transformed);
+					DoNotOptimize(transformed[iteration & inputMask]);
+				}));
+		}
+
+		if (IsSelected("math/vector3_normalized", options))
+		{
+			results.push_back(RunMicroBenchmark("math/vector3_normalized", options, [&](uint32_t iteration)
+				{
+					const Vector3 result{ vectors[iteration & inputMask].Normalized() };
+					DoNotOptimize(result);
+				}));
+		}
+	}
+
+	void RunTextureBenchmarks(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results)
+	{
+		if (!IsSelected("texture/sample", options))
+			return;
+
+		Texture* pTexture{ Texture::LoadFromFile("Resources/uv_grid_2.png") };
+		if (!pTexture)
+		{
+			std::cerr << "Couldn't load the texture, skipping texture/sample" << std::endl;
+			return;
+		}
+
+		// random coordinates, so the cache behaves like a minified texture rather than a magnified one
+		constexpr uint32_t nrInputs{ 4096 };
+		std::mt19937 generator{ 1337 };
+		std::uniform_real_distribution<float> distribution{ 0.f, 1.f };
+
+		std::vector<Vector2> uvs{};
+		for (uint32_t inputIdx{}; inputIdx < nrInputs; ++inputIdx)
+			uvs.emplace_back(distribution(generator), distribution(generator));
+
+		results.push_back(RunMicroBenchmark("texture/sample", options, [&](uint32_t iteration)
+			{
+				const ColorRGB result{ pTexture->Sample(uvs[iteration & (nrInputs - 1)]) };
+				DoNotOptimize(result);
+			}));
+
+		delete pTexture;
+	}
+
+	// Every sample is one frame from the default camera. The raster benchmark is the part of the same frames
+	// spent in RenderTrianglesMesh (depth pre-pass and color draws), the generic one renders those frames again
+	// through the single runtime branching kernel instead of the specialized ones
+	void RunFrameBenchmarks(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results)
+	{
+		struct Resolution
+		{
+			int width;
+			int height;
+		};
+		constexpr Resolution resolutions[]{ { 640, 480 }, { 1280, 720 }, { 1920, 1080 } };
+
+		for (const SceneType scene : { SceneType::Vehicle, SceneType::TukTuk })
+		{
+			for (const Resolution& resolution : resolutions)
+			{
+				const std::string suffix{ std::string{ GetSceneName(scene) } + "/" + std::to_string(resolution.width) + "x" + std::to_string(resolution.height) };
+				const std::string frameName{ "frame/" + suffix };
+				const std::string rasterName{ "raster/" + suffix };
+				const std::string genericRasterName{ rasterName + "/generic" };
+
+				const bool runFrame{ IsSelected(frameName, options) };
+				const bool runRaster{ IsSelected(rasterName, options) };
+				const bool runGenericRaster{ IsSelected(genericRasterName, options) };
+				if (!runFrame && !runRaster && !runGenericRaster)
+					continue;
+
+				Renderer* pRenderer{ new Renderer(resolution.width, resolution.height, scene) };
+				// timing an empty frame would look like a huge speedup, so leave the results out instead
+				if (!pRenderer->HasGeometry())
+				{
+					std::cerr << "Couldn't load the " << GetSceneName(scene) << " scene, skipping the " << suffix << " benchmarks" << std::endl;
+					delete pRenderer;
+					continue;
+				}
+
+				const auto sampleFrames = [&](BenchmarkResult& frameResult, BenchmarkResult& rasterResult)
+				{
+					for (int sampleIdx{}; sampleIdx < options.nrWarmupSamples; ++sampleIdx)
+						pRenderer->Render();
+
+					for (int sampleIdx{}; sampleIdx < options.nrSamples; ++sampleIdx)
+					{
+						const uint64_t startTime{ SDL_GetPerformanceCounter() };
+						pRenderer->Render();
+						frameResult.samples.push_back(GetElapsedMs(startTime));
+						rasterResult.samples.push_back(pRenderer->GetFrameStats().rasterMs);
+					}
+				};
+
+				if (runFrame || runRaster)
+				{
+					BenchmarkResult frameResult{ frameName, "ms", 1 };
+					BenchmarkResult rasterResult{ rasterName, "ms", 1 };
+					sampleFrames(frameResult, rasterResult);
+
+					if (runFrame)
+						results.push_back(std::move(frameResult));
+					if (runRaster)
+						results.push_back(std::move(rasterResult));
+				}
+
+				if (runGenericRaster)
+				{
+					pRenderer->SetSpecializedKernels(false);
+
+					// only the raster part differs between the kernels, the whole frame times are dropped
+					BenchmarkResult frameResult{ frameName, "ms", 1 };
+					BenchmarkResult genericRasterResult{ genericRasterName, "ms", 1 };
+					sampleFrames(frameResult, genericRasterResult);
+
+					results.push_back(std::move(genericRasterResult));
+				}
+
+				delete pRenderer;
+			}
+		}
+	}
+
+	void WriteJson(std::ostream& stream, const BenchmarkOptions& options, const std::vector<BenchmarkResult>& results)
+	{
+		char timestamp[32]{};
+		const std::time_t now{ std::time(nullptr) };
+		std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+#ifdef NDEBUG
+		const char* pConfiguration{ "Release" };
+#else
+		const char* pConfiguration{ "Debug" };
+#endif
+
+		stream << "{\n"
+			<< "  \"timestamp\": \"" << timestamp << "\",\n"
+			<< "  \"configuration\": \"" << pConfiguration << "\",\n"
+			<< "  \"samples\": " << options.nrSamples << ",\n"
+			<< "  \"warmup_samples\": " << options.nrWarmupSamples << ",\n"
+			<< "  \"benchmarks\": [";
+
+		for (size_t resultIdx{}; resultIdx < results.size(); ++resultIdx)
+		{
+			const BenchmarkResult& result{ results[resultIdx] };
+			const SampleStatistics statistics{ CalculateStatistics(result.samples) };
+
+			stream << (resultIdx ? ",\n" : "\n")
+				<< "    {\n"
+				<< "      \"name\": \"" << result.name << "\",\n"
+				<< "      \"unit\": \"" << result.unit << "\",\n"
+				<< "      \"iterations_per_sample\": " << result.iterationsPerSample << ",\n"
+				<< "      \"min\": " << statistics.min << ",\n"
+				<< "      \"max\": " << statistics.max << ",\n"
+				<< "      \"mean\": " << statistics.mean << ",\n"
+				<< "      \"median\": " << statistics.median << ",\n"
+				<< "      \"stddev\": " << statistics.stddev << ",\n"
+				<< "      \"p95\": " << statistics.p95 << ",\n"
+				<< "      \"ci95\": [" << statistics.ciLow << ", " << statistics.ciHigh << "],\n"
+				<< "      \"samples\": [";
+
+			for (size_t sampleIdx{}; sampleIdx < result.samples.size(); ++sampleIdx)
+				stream << (sampleIdx ? ", " : "") << result.samples[sampleIdx];
+
+			stream << "]\n"
+				<< "    }";
+		}
+
+		stream << "\n  ]\n}" << std::endl;
+	}
+
+	void PrintUsage()
+	{
+		std::cout << "Usage: Benchmarks [--filter text] [--samples N] [--warmup N] [--min-sample-ms T] [--output results.json]\n"
+			<< "Benchmarks: math/matrix_multiply, math/matrix_inverse, math/transform_point, math/transform_points (256 points),\n"
+			<< "            math/vector3_normalized, texture/sample,\n"
+			<< "            frame/<scene>/<WxH>, raster/<scene>/<WxH> and raster/<scene>/<WxH>/generic (the runtime branching kernel)\n"
+			<< "            for vehicle and tuktuk at 640x480, 1280x720, 1920x1080" << std::endl;
+	}
+
+	bool ParseCommandLine(int argc, char* args[], BenchmarkOptions& options)
+	{
+		for (int argIdx{ 1 }; argIdx + 1 < argc; argIdx += 2)
+		{
+			const std::string option{ args[argIdx] };
+			const std::string value{ args[argIdx + 1] };
+
+			if (option == "--filter")
+				options.filter = value;
+			else if (option == "--output")
+				options.outputPath = value;
+			else if (option == "--samples")
+				options.nrSamples = std::atoi(value.c_str());
+			else if (option == "--warmup")
+				options.nrWarmupSamples = std::atoi(value.c_str());
+			else if (option == "--min-sample-ms")
+				options.minSampleMs = static_cast<float>(std::atof(value.c_str()));
+			else
+				return false;
+		}
+
+		// every option takes a value
+		return argc % 2 == 1 && options.nrSamples > 1 && options.nrWarmupSamples >= 0 && options.minSampleMs > 0.f;
+	}
+}
+
+int main(int argc, char* args[])
+{
+	BenchmarkOptions options{};
+	if (!ParseCommandLine(argc, args, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	std::vector<BenchmarkResult> results{};
+	RunMathBenchmarks(options, results);
+	RunTextureBenchmarks(options, results);
+	RunFrameBenchmarks(options, results);
+
+	if (options.outputPath.empty())
+	{
+		WriteJson(std::cout, options, results);
+		return 0;
+	}
+
+	std::ofstream file{ options.outputPath };
+	if (!file)
+	{
+		std::cerr << "Couldn't open " << options.outputPath << std::endl;
+		return 1;
+	}
+	WriteJson(file, options, results);
+
+	for (const BenchmarkResult& result : results)
+	{
+		const SampleStatistics statistics{ CalculateStatistics(result.samples) };
+		std::cout << result.name << ": median " << statistics.median << " " << result.unit
+			<< " (95% CI " << statistics.ciLow << " - " << statistics.ciHigh << ")" << std::endl;
+	}
+	std::cout << "Results written to " << options.outputPath << std::endl;
+	return 0;
+}
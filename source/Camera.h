@@ -39,11 +39,18 @@ namespace dae
 		Matrix invViewMatrix{};
 		Matrix viewMatrix{};
 		Matrix projectionMatrix{};
+		// viewMatrix * projectionMatrix
+		Matrix viewProjectionMatrix{};
+		// Bumped whenever the matrices above change, caches built from them (Mesh::worldViewProjection) compare against it
+		uint32_t matrixVersion{};
 
 		//CalcProjMatrix
 		float nearVP{ 0.1f };
 		float farVP{ 100.f };
 
+		// reversed-z maps the near plane to 1 and the far plane to 0 (better float precision)
+		bool isReversedZ{ false };
+
 		void Initialize(float _aspectRatio, float _fovAngle = 90.f, Vector3 _origin = { 0.f,0.f,0.f })
 		{
 			aspectRatio = _aspectRatio;
@@ -52,20 +59,43 @@ namespace dae
 
 			origin = _origin;
 			forward = Vector3::UnitZ;
+
+			// valid matrices before the first Update, a headless renderer may never call it
+			CalculateViewMatrix();
+			CalculateProjectionMatrix();
+		}
+
+		// Places the camera without input, pitch and yaw in degrees with the same convention as the mouse look
+		void SetPose(const Vector3& _origin, float pitch, float yaw)
+		{
+			origin = _origin;
+			totalPitch = pitch;
+			totalYaw = yaw;
+
+			const Matrix finalRot = Matrix::CreateRotationX(totalPitch * TO_RADIANS) * Matrix::CreateRotationY(totalYaw * TO_RADIANS);
+			forward = finalRot.TransformVector(Vector3::UnitZ);
+			forward.Normalize();
+
+			CalculateViewMatrix();
+			CalculateProjectionMatrix();
 		}
 
 		void CalculateViewMatrix()
 		{
 			//TODO W1
 
-			//ViewMatrix => Matrix::CreateLookAtLH(...) [not implemented yet]
+			//ViewMatrix => same as Matrix::CreateLookAtLH(origin, forward, Vector3::UnitY),
+			//built here since the camera keeps right, up and the inverse around
 			//DirectX Implementation => https://learn.microsoft.com/en-us/windows/win32/direct3d9/d3dxmatrixlookatlh
 
 			right = Vector3::Cross(Vector3::UnitY, forward).Normalized();
 			up = Vector3::Cross(forward, right);
 
+			// the camera's axes are orthonormal, so the rigid inverse is enough
 			invViewMatrix = Matrix{ right,up,forward,origin };
-			viewMatrix = invViewMatrix.Inverse();
+			viewMatrix = Matrix::InverseRigid(invViewMatrix);
+
+			UpdateViewProjectionMatrix();
 		}
 
 		void CalculateProjectionMatrix()
@@ -85,13 +115,36 @@ namespace dae
 			auto xScale = 1 / (aspectRatio * fov);
 			auto yScale = 1 / fov;
 
+			// reversed: zn / (zn - zf) and -zn * zf / (zn - zf), same matrix with near and far swapped
+			const float zNear{ isReversedZ ? farVP : nearVP };
+			const float zFar{ isReversedZ ? nearVP : farVP };
+
 			projectionMatrix = Matrix{ Vector4{ xScale, 0, 0, 0 },
 										Vector4{ 0, yScale, 0, 0 },
-										Vector4{ 0, 0 , farVP / (farVP - nearVP), 1},
-										Vector4{ 0 , 0 ,-(nearVP * farVP) / (farVP - nearVP), 0} };
+										Vector4{ 0, 0 , zFar / (zFar - zNear), 1},
+										Vector4{ 0 , 0 ,-(zNear * zFar) / (zFar - zNear), 0} };
 
-			//ProjectionMatrix => Matrix::CreatePerspectiveFovLH(...) [not implemented yet]
+			//ProjectionMatrix => same as Matrix::CreatePerspectiveFovLH(fovAngle * TO_RADIANS, aspectRatio, zNear, zFar),
+			//built here from the cached tan of the half fov
 			//DirectX Implementation => https://learn.microsoft.com/en-us/windows/win32/direct3d9/d3dxmatrixperspectivefovlh
+
+			UpdateViewProjectionMatrix();
+		}
+
+		void UpdateViewProjectionMatrix()
+		{
+			viewProjectionMatrix = viewMatrix * projectionMatrix;
+			++matrixVersion;
+		}
+
+		// Converts a device depth back to a [0, 1] linear distance between the near and far plane
+		float LinearizeDepth(float depth) const
+		{
+			const float zNear{ isReversedZ ? farVP : nearVP };
+			const float zFar{ isReversedZ ? nearVP : farVP };
+
+			const float viewDepth{ (zNear * zFar) / (zFar - depth * (zFar - zNear)) };
+			return Saturate((viewDepth - nearVP) / (farVP - nearVP));
 		}
 
 		void Update(Timer* pTimer)
@@ -99,30 +152,39 @@ namespace dae
 			const float deltaTime = pTimer->GetElapsed();
 			const uint8_t* pKeyboardState = SDL_GetKeyboardState(nullptr);
 
+			// origin or forward changed this frame, the view matrix is left alone otherwise
+			bool isViewDirty{ false };
+
 			// keyboard movement
 			if (pKeyboardState[SDL_SCANCODE_W])
 			{
 				origin += forward * movementSpeed * deltaTime;
+				isViewDirty = true;
 			}
 			if (pKeyboardState[SDL_SCANCODE_S])
 			{
 				origin -= forward * movementSpeed * deltaTime;
+				isViewDirty = true;
 			}
 			if (pKeyboardState[SDL_SCANCODE_D])
 			{
 				origin += right * movementSpeed * deltaTime;
+				isViewDirty = true;
 			}
 			if (pKeyboardState[SDL_SCANCODE_A])
 			{
 				origin -= right * movementSpeed * deltaTime;
+				isViewDirty = true;
 			}
 			if (pKeyboardState[SDL_SCANCODE_SPACE])
 			{
 				origin += up * movementSpeed * deltaTime;
+				isViewDirty = true;
 			}
 			if (pKeyboardState[SDL_SCANCODE_LSHIFT])
 			{
 				origin -= up * movementSpeed * deltaTime;
+				isViewDirty = true;
 			}
 
 
@@ -136,6 +198,7 @@ namespace dae
 			{
 				const float upwards = -mouseY * movementSpeed * deltaTime;
 				origin += up * upwards;
+				isViewDirty = true;
 			}
 			else if (mouseState & SDL_BUTTON(SDL_BUTTON_LEFT))
 			{
@@ -152,6 +215,7 @@ namespace dae
 				const Matrix finalRot = Matrix::CreateRotationX(totalPitch * TO_RADIANS) * Matrix::CreateRotationY(totalYaw * TO_RADIANS);
 				forward = finalRot.TransformVector(Vector3::UnitZ);
 				forward.Normalize();
+				isViewDirty = true;
 			}
 			else if (mouseState & SDL_BUTTON(SDL_BUTTON_RIGHT))
 			{
@@ -172,10 +236,13 @@ namespace dae
 				const Matrix finalRot = Matrix::CreateRotationX(totalPitch * TO_RADIANS) * Matrix::CreateRotationY(totalYaw * TO_RADIANS);
 				forward = finalRot.TransformVector(Vector3::UnitZ);
 				forward.Normalize();
+				isViewDirty = true;
 			}
 
-			CalculateViewMatrix();
-			CalculateProjectionMatrix();
+			// The projection only changes through Initialize or whoever edits its parameters
+			// (isReversedZ, nearVP, farVP), they call CalculateProjectionMatrix themselves
+			if (isViewDirty)
+				CalculateViewMatrix();
 		}
 
 	};
@@ -0,0 +1,124 @@
+#include "CameraPath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace dae
+{
+	CameraPath CameraPath::CreateStatic(const Vector3& origin, float pitch, float yaw)
+	{
+		CameraPath path{};
+		path.m_Keys.push_back(CameraKey{ 0.f, origin, pitch, yaw });
+		return path;
+	}
+
+	CameraPath CameraPath::CreateOrbit(const Vector3& target, float radius, float height, float duration)
+	{
+		// enough keys that the straight segments between them stay close to the circle
+		constexpr int nrKeys{ 65 };
+
+		CameraPath path{};
+		path.m_Keys.reserve(nrKeys);
+
+		for (int keyIdx{}; keyIdx < nrKeys; ++keyIdx)
+		{
+			const float fraction{ static_cast<float>(keyIdx) / (nrKeys - 1) };
+			const float angle{ fraction * 2.f * PI };
+
+			// starts behind the target on -z, same side the default camera is on
+			const Vector3 origin{ target + Vector3{ radius * sinf(angle), height, -radius * cosf(angle) } };
+			const Vector3 forward{ (target - origin).Normalized() };
+
+			// inverse of the mouse look: forward = (cos(pitch) * sin(yaw), sin(pitch), cos(pitch) * cos(yaw))
+			const float pitch{ asinf(forward.y) * TO_DEGREES };
+			float yaw{ atan2f(forward.x, forward.z) * TO_DEGREES };
+
+			// keep the yaw increasing so interpolating between keys doesn't spin the wrong way around
+			if (!path.m_Keys.empty())
+			{
+				const float previousYaw{ path.m_Keys.back().yaw };
+				while (yaw < previousYaw - 180.f) yaw += 360.f;
+				while (yaw > previousYaw + 180.f) yaw -= 360.f;
+			}
+
+			path.m_Keys.push_back(CameraKey{ fraction * duration, origin, pitch, yaw });
+		}
+
+		return path;
+	}
+
+	bool CameraPath::LoadFromFile(const std::string& path)
+	{
+		std::ifstream file{ path };
+		if (!file)
+			return false;
+
+		std::vector<CameraKey> keys{};
+		std::string line{};
+		while (std::getline(file, line))
+		{
+			if (line.empty() || line[0] == '#')
+				continue;
+
+			std::istringstream lineStream{ line };
+			CameraKey key{};
+			if (!(lineStream >> key.time >> key.origin.x >> key.origin.y >> key.origin.z >> key.pitch >> key.yaw))
+				return false;
+
+			keys.push_back(key);
+		}
+
+		if (keys.empty())
+			return false;
+
+		std::stable_sort(keys.begin(), keys.end(), [](const CameraKey& a, const CameraKey& b) { return a.time < b.time; });
+		m_Keys = std::move(keys);
+		return true;
+	}
+
+	bool CameraPath::SaveToFile(const std::string& path) const
+	{
+		std::ofstream file{ path };
+		if (!file)
+			return false;
+
+		file << "# time x y z pitch yaw\n" << std::setprecision(std::numeric_limits<float>::max_digits10);
+		for (const CameraKey& key : m_Keys)
+		{
+			file << key.time << " " << key.origin.x << " " << key.origin.y << " " << key.origin.z << " " << key.pitch << " " << key.yaw << "\n";
+		}
+
+		return static_cast<bool>(file);
+	}
+
+	CameraKey CameraPath::Sample(float time) const
+	{
+		if (m_Keys.empty())
+			return CameraKey{ time };
+
+		if (time <= m_Keys.front().time)
+			return CameraKey{ time, m_Keys.front().origin, m_Keys.front().pitch, m_Keys.front().yaw };
+		if (time >= m_Keys.back().time)
+			return CameraKey{ time, m_Keys.back().origin, m_Keys.back().pitch, m_Keys.back().yaw };
+
+		// first key after time, the one before it is the start of the segment
+		const auto next{ std::upper_bound(m_Keys.begin(), m_Keys.end(), time,
+			[](float t, const CameraKey& key) { return t < key.time; }) };
+		const CameraKey& to{ *next };
+		const CameraKey& from{ *(next - 1) };
+
+		const float segmentLength{ to.time - from.time };
+		const float t{ segmentLength > 0.f ? (time - from.time) / segmentLength : 1.f };
+
+		return CameraKey{
+			time,
+			from.origin + (to.origin - from.origin) * t,
+			Lerpf(from.pitch, to.pitch, t),
+			Lerpf(from.yaw, to.yaw, t)
+		};
+	}
+}
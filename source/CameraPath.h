@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Math.h"
+
+namespace dae
+{
+	// Camera pose at a point in time, pitch and yaw in degrees like Camera::totalPitch/totalYaw
+	struct CameraKey
+	{
+		float time{};
+		Vector3 origin{};
+		float pitch{};
+		float yaw{};
+	};
+
+	// Keyframed camera motion, sampled with linear interpolation between the keys.
+	// Drives the camera when rendering without input (headless runs and replays), recordings of live sessions
+	// are built key by key and saved in the same format
+	class CameraPath final
+	{
+	public:
+		CameraPath() = default;
+
+		// One key, the camera doesn't move
+		static CameraPath CreateStatic(const Vector3& origin, float pitch = 0.f, float yaw = 0.f);
+		// Full circle around target in duration seconds, looking at it the whole time
+		static CameraPath CreateOrbit(const Vector3& target, float radius, float height, float duration);
+
+		// Text file, one key per line: time x y z pitch yaw, lines starting with # are skipped
+		bool LoadFromFile(const std::string& path);
+		// Same format, written with enough digits that loading gives back the exact same floats
+		bool SaveToFile(const std::string& path) const;
+
+		// Keys have to be added in time order
+		void AddKey(const CameraKey& key) { m_Keys.push_back(key); }
+
+		// Times before the first or after the last key clamp to that key
+		CameraKey Sample(float time) const;
+
+		bool IsEmpty() const { return m_Keys.empty(); }
+		size_t GetNrKeys() const { return m_Keys.size(); }
+		float GetDuration() const { return m_Keys.empty() ? 0.f : m_Keys.back().time; }
+
+	private:
+		std::vector<CameraKey> m_Keys{};
+	};
+}
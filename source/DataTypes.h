@@ -1,6 +1,8 @@
 #pragma once
 #include "Math.h"
 #include "vector"
+#include <cstdint>
+#include <span>
 
 namespace dae
 {
@@ -14,14 +16,21 @@ namespace dae
 		Vector3 viewDirection{}; //W4
 	};
 
+	// 22 bytes instead of the 68 of Vertex, see VertexQuantization.h
+	// viewDirection isn't stored, it's computed per frame
+	struct QuantizedVertex
+	{
+		uint16_t position[3]{}; // unorm16 within the mesh AABB
+		uint16_t uv[2]{}; // half floats
+		uint16_t normal[2]{}; // octahedral, snorm16
+		uint16_t tangent[2]{}; // octahedral, snorm16
+		uint8_t color[3]{}; // unorm8
+	};
+
+	// Only the projected position, the interpolated attributes live packed in Mesh::varyings_out
 	struct Vertex_Out
 	{
 		Vector4 position{};
-		ColorRGB color{ colors::White };
-		Vector2 uv{};
-		Vector3 normal{};
-		Vector3 tangent{};
-		Vector3 viewDirection{};
 	};
 
 	enum class PrimitiveTopology
@@ -30,13 +39,60 @@ namespace dae
 		TriangleStrip
 	};
 
+	// Run of consecutive triangles that gets culled as a whole, see MeshClusters.h
+	struct MeshCluster
+	{
+		uint32_t firstTriangle{};
+		uint32_t triangleCount{};
+		// unique vertices of the cluster, range in Mesh::clusterVertexIndices
+		uint32_t firstVertex{};
+		uint32_t vertexCount{};
+
+		Vector3 boundsCenter{};
+		float boundsRadius{};
+
+		// every triangle normal is within acos(coneCutoff) of the axis, <= 0 can't be backface culled
+		Vector3 coneAxis{};
+		float coneCutoff{};
+	};
+
 	struct Mesh
 	{
 		std::vector<Vertex> vertices{};
 		std::vector<uint32_t> indices{};
 		PrimitiveTopology primitiveTopology{ PrimitiveTopology::TriangleStrip };
 
-		std::vector<Vertex_Out> vertices_out{};
+		// Optional compact copy of vertices (QuantizeMesh), the vertex stage reads this one when it's filled
+		std::vector<QuantizedVertex> quantizedVertices{};
+		Vector3 quantizationMin{};
+		Vector3 quantizationScale{};
+
+		// Built at load with BuildClusters, a mesh without clusters doesn't get drawn
+		std::vector<MeshCluster> clusters{};
+		std::vector<uint32_t> clusterVertexIndices{};
+		// sphere around the whole mesh in object space, also from BuildClusters
+		Vector3 boundsCenter{};
+		float boundsRadius{};
+
+		// rendered into the occlusion buffer, other meshes get tested against it
+		bool isOccluder{ false };
+
+		// Vertex stage output, points into the renderer's frame arena so it's only valid for the frame it got transformed in
+		std::span<Vertex_Out> vertices_out{};
+		// attribute / w per vertex, laid out by the VaryingLayout of the current pipeline
+		std::span<float> varyings_out{};
+		// indices of the clusters that survived culling this frame, frame arena as well
+		std::span<uint32_t> visibleClusters_out{};
 		Matrix worldMatrix{};
+
+		// worldMatrix * view * projection, refreshed by the renderer at the start of a frame (UpdateWorldViewProjections)
+		// only when the camera's Camera::matrixVersion or worldMatrix differ from what it was built with
+		Matrix worldViewProjection{};
+		Matrix worldViewProjectionWorld{};
+		// 0: never built, the camera is at 1 or higher once it has matrices
+		uint32_t worldViewProjectionVersion{};
+
+		// 255 is reserved, the gbuffer uses it for empty pixels (GBuffer::InvalidMaterial)
+		uint8_t materialId{};
 	};
 }
\ No newline at end of file
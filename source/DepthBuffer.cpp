@@ -0,0 +1,200 @@
+#include "DepthBuffer.h"
+
+#include <algorithm>
+
+namespace dae
+{
+	DepthBuffer::DepthBuffer(int width, int height, DepthFormat format) :
+		m_Width{ width },
+		m_Height{ height },
+		m_Format{ format }
+	{
+		m_pData = new uint8_t[static_cast<size_t>(m_Width) * m_Height * sizeof(float)];
+
+		m_TilesX = (m_Width + TileSize - 1) / TileSize;
+		m_TilesY = (m_Height + TileSize - 1) / TileSize;
+		m_pTileCleared = new uint8_t[static_cast<size_t>(m_TilesX) * m_TilesY];
+		m_pTileFarDepth = new float[static_cast<size_t>(m_TilesX) * m_TilesY];
+		m_pTileNearDepth = new float[static_cast<size_t>(m_TilesX) * m_TilesY];
+		m_pTileFarDirty = new uint8_t[static_cast<size_t>(m_TilesX) * m_TilesY];
+
+		Clear();
+	}
+
+	DepthBuffer::~DepthBuffer()
+	{
+		delete[] m_pData;
+		m_pData = nullptr;
+		delete[] m_pTileCleared;
+		m_pTileCleared = nullptr;
+		delete[] m_pTileFarDepth;
+		m_pTileFarDepth = nullptr;
+		delete[] m_pTileNearDepth;
+		m_pTileNearDepth = nullptr;
+		delete[] m_pTileFarDirty;
+		m_pTileFarDirty = nullptr;
+	}
+
+	void DepthBuffer::SetFormat(DepthFormat format)
+	{
+		m_Format = format;
+		Clear();
+	}
+
+	void DepthBuffer::Clear()
+	{
+		// O(tiles) instead of O(pixels)
+		std::fill_n(m_pTileCleared, static_cast<size_t>(m_TilesX) * m_TilesY, uint8_t{ 1 });
+	}
+
+	float DepthBuffer::GetClearDepth() const
+	{
+		switch (m_Format)
+		{
+		case DepthFormat::D32Float:
+			return FLT_MAX;
+		case DepthFormat::D32FloatReversed:
+			// far plane sits at 0 with reversed-z
+			return 0.f;
+		case DepthFormat::D24Unorm:
+		case DepthFormat::D16Unorm:
+			return 1.f;
+		}
+		return FLT_MAX;
+	}
+
+	void DepthBuffer::ClearPixels(size_t firstPixel, size_t nrPixels)
+	{
+		switch (m_Format)
+		{
+		case DepthFormat::D32Float:
+		case DepthFormat::D32FloatReversed:
+			std::fill_n(reinterpret_cast<float*>(m_pData) + firstPixel, nrPixels, GetClearDepth());
+			break;
+		case DepthFormat::D24Unorm:
+			std::fill_n(m_pData + firstPixel * 3, nrPixels * 3, uint8_t{ 0xFF });
+			break;
+		case DepthFormat::D16Unorm:
+			std::fill_n(reinterpret_cast<uint16_t*>(m_pData) + firstPixel, nrPixels, static_cast<uint16_t>(m_D16Max));
+			break;
+		}
+	}
+
+	void DepthBuffer::MaterializeTile(int tileIdx)
+	{
+		const int tileX{ (tileIdx % m_TilesX) * TileSize };
+		const int tileY{ (tileIdx / m_TilesX) * TileSize };
+		const int tileWidth{ std::min(TileSize, m_Width - tileX) };
+		const int tileHeight{ std::min(TileSize, m_Height - tileY) };
+
+		for (int py{ tileY }; py < tileY + tileHeight; ++py)
+		{
+			ClearPixels(static_cast<size_t>(tileX) + static_cast<size_t>(py) * m_Width, tileWidth);
+		}
+
+		m_pTileCleared[tileIdx] = 0;
+		m_pTileFarDepth[tileIdx] = GetClearDepth();
+		m_pTileNearDepth[tileIdx] = GetClearDepth();
+		m_pTileFarDirty[tileIdx] = 0;
+	}
+
+	void DepthBuffer::UpdateTileFarDepth(int tileIdx)
+	{
+		const int tileX{ (tileIdx % m_TilesX) * TileSize };
+		const int tileY{ (tileIdx / m_TilesX) * TileSize };
+		const int tileWidth{ std::min(TileSize, m_Width - tileX) };
+		const int tileHeight{ std::min(TileSize, m_Height - tileY) };
+
+		// reduced in the stored representation, only the result gets decoded
+		float farDepth{};
+		switch (m_Format)
+		{
+		case DepthFormat::D32Float:
+		case DepthFormat::D32FloatReversed:
+		{
+			const bool isReversed{ IsReversed() };
+			farDepth = isReversed ? FLT_MAX : 0.f;
+			for (int py{ tileY }; py < tileY + tileHeight; ++py)
+			{
+				const float* pRow{ reinterpret_cast<const float*>(m_pData) + tileX + static_cast<size_t>(py) * m_Width };
+				for (int px{}; px < tileWidth; ++px)
+				{
+					farDepth = isReversed ? std::min(farDepth, pRow[px]) : std::max(farDepth, pRow[px]);
+				}
+			}
+			break;
+		}
+		case DepthFormat::D24Unorm:
+		{
+			uint32_t farthest{};
+			for (int py{ tileY }; py < tileY + tileHeight; ++py)
+			{
+				const uint8_t* pRow{ m_pData + (tileX + static_cast<size_t>(py) * m_Width) * 3 };
+				for (int px{}; px < tileWidth; ++px)
+				{
+					const uint8_t* pDepth{ pRow + px * 3 };
+					farthest = std::max(farthest, static_cast<uint32_t>(pDepth[0]) | (static_cast<uint32_t>(pDepth[1]) << 8) | (static_cast<uint32_t>(pDepth[2]) << 16));
+				}
+			}
+			farDepth = static_cast<float>(farthest) / static_cast<float>(m_D24Max);
+			break;
+		}
+		case DepthFormat::D16Unorm:
+		{
+			uint16_t farthest{};
+			for (int py{ tileY }; py < tileY + tileHeight; ++py)
+			{
+				const uint16_t* pRow{ reinterpret_cast<const uint16_t*>(m_pData) + tileX + static_cast<size_t>(py) * m_Width };
+				for (int px{}; px < tileWidth; ++px)
+				{
+					farthest = std::max(farthest, pRow[px]);
+				}
+			}
+			farDepth = static_cast<float>(farthest) / static_cast<float>(m_D16Max);
+			break;
+		}
+		}
+
+		m_pTileFarDepth[tileIdx] = farDepth;
+		m_pTileFarDirty[tileIdx] = 0;
+	}
+
+	int DepthBuffer::GetBytesPerPixel(DepthFormat format)
+	{
+		switch (format)
+		{
+		case DepthFormat::D32Float:
+		case DepthFormat::D32FloatReversed:
+			return 4;
+		case DepthFormat::D24Unorm:
+			return 3;
+		case DepthFormat::D16Unorm:
+			return 2;
+		}
+		return 4;
+	}
+
+	const char* DepthBuffer::GetFormatName(DepthFormat format)
+	{
+		switch (format)
+		{
+		case DepthFormat::D32Float:
+			return "D32 Float";
+		case DepthFormat::D32FloatReversed:
+			return "D32 Float (reversed-z)";
+		case DepthFormat::D24Unorm:
+			return "D24 Unorm";
+		case DepthFormat::D16Unorm:
+			return "D16 Unorm";
+		}
+		return "Unknown";
+	}
+
+	uint64_t DepthBuffer::GetFrameTrafficBytes(DepthFormat format, int width, int height, float depthComplexity)
+	{
+		const uint64_t bufferBytes{ static_cast<uint64_t>(width) * height * GetBytesPerPixel(format) };
+
+		// clear writes the whole buffer once, every fragment reads and (worst case) writes its depth
+		return bufferBytes + static_cast<uint64_t>(2.f * depthComplexity * static_cast<float>(bufferBytes));
+	}
+}
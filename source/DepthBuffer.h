@@ -0,0 +1,290 @@
+#pragma once
+#include <cstdint>
+#include <cfloat>
+#include <algorithm>
+
+#include "MathHelpers.h"
+
+namespace dae
+{
+	enum class DepthFormat
+	{
+		D32Float,
+		D32FloatReversed,
+		D24Unorm,
+		D16Unorm
+	};
+
+	class DepthBuffer final
+	{
+	public:
+		DepthBuffer(int width, int height, DepthFormat format = DepthFormat::D32Float);
+		~DepthBuffer();
+
+		DepthBuffer(const DepthBuffer&) = delete;
+		DepthBuffer(DepthBuffer&&) noexcept = delete;
+		DepthBuffer& operator=(const DepthBuffer&) = delete;
+		DepthBuffer& operator=(DepthBuffer&&) noexcept = delete;
+
+		void SetFormat(DepthFormat format);
+		DepthFormat GetFormat() const { return m_Format; }
+		bool IsReversed() const { return m_Format == DepthFormat::D32FloatReversed; }
+
+		// Fast clear: only flags every tile as cleared, the pixels of a tile get their clear value
+		// the first time the tile is touched (see MaterializeTile)
+		void Clear();
+
+		// Depth test + write in one go, depth is the device depth coming out of the projection
+		// (near = 0 / far = 1, or the other way around for the reversed format)
+		inline bool TestAndWrite(int px, int py, float depth);
+
+		// Depth test "equal" without writing, used by the color pass after a depth pre-pass
+		inline bool TestEqual(int px, int py, float depth) const;
+
+		// Same tests with the format known at compile time, for the specialized raster kernels
+		template<DepthFormat Format>
+		inline bool TestAndWrite(int px, int py, float depth);
+		template<DepthFormat Format>
+		inline bool TestEqual(int px, int py, float depth) const;
+
+		// Hierarchical z: true when a fragment with a depth in [minDepth, maxDepth] can't pass anywhere in the tile,
+		// because even its nearest depth is behind the farthest depth stored in the tile
+		inline bool IsTileHidden(int tileX, int tileY, float minDepth, float maxDepth);
+
+		template<DepthFormat Format>
+		inline bool IsTileHidden(int tileX, int tileY, float minDepth, float maxDepth);
+
+		// Returns the stored device depth, decoded back to a float
+		inline float GetDepth(int px, int py) const;
+		float GetClearDepth() const;
+
+		static constexpr int TileShift{ 3 };
+		static constexpr int TileSize{ 1 << TileShift };
+
+		int GetBytesPerPixel() const { return GetBytesPerPixel(m_Format); }
+
+		static int GetBytesPerPixel(DepthFormat format);
+		static const char* GetFormatName(DepthFormat format);
+
+		// Estimated depth traffic for one frame: clear + one read and one write per covered pixel,
+		// times the depth complexity (average amount of fragments per pixel)
+		static uint64_t GetFrameTrafficBytes(DepthFormat format, int width, int height, float depthComplexity = 1.f);
+
+	private:
+		int m_Width{};
+		int m_Height{};
+		DepthFormat m_Format{ DepthFormat::D32Float };
+
+		// raw storage, sized for the widest format so switching formats doesn't reallocate
+		uint8_t* m_pData{ nullptr };
+
+		int m_TilesX{};
+		int m_TilesY{};
+		// 1 when the tile still logically holds the clear value and its pixels haven't been written yet
+		uint8_t* m_pTileCleared{ nullptr };
+
+		// Farthest depth per tile. Writes only bring depths closer, so the stored value stays a valid (loose) bound
+		// after a write and just gets flagged, it's tightened again the next time the tile gets tested.
+		// The nearest depth written to the tile tells when a rescan can't make a difference
+		float* m_pTileFarDepth{ nullptr };
+		float* m_pTileNearDepth{ nullptr };
+		uint8_t* m_pTileFarDirty{ nullptr };
+
+		void MarkTileWritten(int tileIdx, float depth)
+		{
+			m_pTileFarDirty[tileIdx] = 1;
+			m_pTileNearDepth[tileIdx] = IsReversed() ? std::max(m_pTileNearDepth[tileIdx], depth) : std::min(m_pTileNearDepth[tileIdx], depth);
+		}
+
+		void ClearPixels(size_t firstPixel, size_t nrPixels);
+		void MaterializeTile(int tileIdx);
+		void UpdateTileFarDepth(int tileIdx);
+
+		static constexpr uint32_t m_D16Max{ 0xFFFF };
+		static constexpr uint32_t m_D24Max{ 0xFFFFFF };
+
+		static uint32_t EncodeUnorm(float depth, uint32_t maxValue)
+		{
+			return static_cast<uint32_t>(Saturate(depth) * static_cast<float>(maxValue) + 0.5f);
+		}
+	};
+
+	template<DepthFormat Format>
+	inline bool DepthBuffer::TestAndWrite(int px, int py, float depth)
+	{
+		const int tileIdx{ (px >> TileShift) + (py >> TileShift) * m_TilesX };
+		if (m_pTileCleared[tileIdx])
+			MaterializeTile(tileIdx);
+
+		const int pixelIdx{ px + (py * m_Width) };
+
+		if constexpr (Format == DepthFormat::D32Float)
+		{
+			float* pDepth{ reinterpret_cast<float*>(m_pData) + pixelIdx };
+			if (depth > *pDepth) return false;
+			*pDepth = depth;
+			MarkTileWritten(tileIdx, depth);
+			return true;
+		}
+		else if constexpr (Format == DepthFormat::D32FloatReversed)
+		{
+			// reversed-z: near plane is 1, far plane is 0, so closer means bigger
+			float* pDepth{ reinterpret_cast<float*>(m_pData) + pixelIdx };
+			if (depth < *pDepth) return false;
+			*pDepth = depth;
+			MarkTileWritten(tileIdx, depth);
+			return true;
+		}
+		else if constexpr (Format == DepthFormat::D24Unorm)
+		{
+			// packed as 3 bytes per pixel, little endian
+			uint8_t* pDepth{ m_pData + pixelIdx * 3 };
+			const uint32_t stored{ static_cast<uint32_t>(pDepth[0]) | (static_cast<uint32_t>(pDepth[1]) << 8) | (static_cast<uint32_t>(pDepth[2]) << 16) };
+			const uint32_t encoded{ EncodeUnorm(depth, m_D24Max) };
+			if (encoded > stored) return false;
+			pDepth[0] = static_cast<uint8_t>(encoded);
+			pDepth[1] = static_cast<uint8_t>(encoded >> 8);
+			pDepth[2] = static_cast<uint8_t>(encoded >> 16);
+			MarkTileWritten(tileIdx, depth);
+			return true;
+		}
+		else
+		{
+			uint16_t* pDepth{ reinterpret_cast<uint16_t*>(m_pData) + pixelIdx };
+			const uint32_t encoded{ EncodeUnorm(depth, m_D16Max) };
+			if (encoded > *pDepth) return false;
+			*pDepth = static_cast<uint16_t>(encoded);
+			MarkTileWritten(tileIdx, depth);
+			return true;
+		}
+	}
+
+	inline bool DepthBuffer::TestAndWrite(int px, int py, float depth)
+	{
+		switch (m_Format)
+		{
+		case DepthFormat::D32Float:
+			return TestAndWrite<DepthFormat::D32Float>(px, py, depth);
+		case DepthFormat::D32FloatReversed:
+			return TestAndWrite<DepthFormat::D32FloatReversed>(px, py, depth);
+		case DepthFormat::D24Unorm:
+			return TestAndWrite<DepthFormat::D24Unorm>(px, py, depth);
+		case DepthFormat::D16Unorm:
+			return TestAndWrite<DepthFormat::D16Unorm>(px, py, depth);
+		}
+		return false;
+	}
+
+	template<DepthFormat Format>
+	inline bool DepthBuffer::TestEqual(int px, int py, float depth) const
+	{
+		// nothing got written in a cleared tile, so nothing can be equal
+		if (m_pTileCleared[(px >> TileShift) + (py >> TileShift) * m_TilesX])
+			return false;
+
+		const int pixelIdx{ px + (py * m_Width) };
+
+		if constexpr (Format == DepthFormat::D32Float || Format == DepthFormat::D32FloatReversed)
+		{
+			return reinterpret_cast<const float*>(m_pData)[pixelIdx] == depth;
+		}
+		else if constexpr (Format == DepthFormat::D24Unorm)
+		{
+			const uint8_t* pDepth{ m_pData + pixelIdx * 3 };
+			const uint32_t stored{ static_cast<uint32_t>(pDepth[0]) | (static_cast<uint32_t>(pDepth[1]) << 8) | (static_cast<uint32_t>(pDepth[2]) << 16) };
+			return EncodeUnorm(depth, m_D24Max) == stored;
+		}
+		else
+		{
+			return EncodeUnorm(depth, m_D16Max) == reinterpret_cast<const uint16_t*>(m_pData)[pixelIdx];
+		}
+	}
+
+	inline bool DepthBuffer::TestEqual(int px, int py, float depth) const
+	{
+		switch (m_Format)
+		{
+		case DepthFormat::D32Float:
+			return TestEqual<DepthFormat::D32Float>(px, py, depth);
+		case DepthFormat::D32FloatReversed:
+			return TestEqual<DepthFormat::D32FloatReversed>(px, py, depth);
+		case DepthFormat::D24Unorm:
+			return TestEqual<DepthFormat::D24Unorm>(px, py, depth);
+		case DepthFormat::D16Unorm:
+			return TestEqual<DepthFormat::D16Unorm>(px, py, depth);
+		}
+		return false;
+	}
+
+	template<DepthFormat Format>
+	inline bool DepthBuffer::IsTileHidden(int tileX, int tileY, float minDepth, float maxDepth)
+	{
+		const int tileIdx{ tileX + tileY * m_TilesX };
+
+		// a cleared tile holds the far plane everywhere
+		if (m_pTileCleared[tileIdx])
+			return false;
+
+		if (m_pTileFarDirty[tileIdx])
+		{
+			// the far depth is never in front of the nearest written one, so no rescan could hide the range
+			const float nearDepth{ m_pTileNearDepth[tileIdx] };
+			if (Format == DepthFormat::D32FloatReversed ? maxDepth >= nearDepth : minDepth <= nearDepth)
+				return false;
+
+			UpdateTileFarDepth(tileIdx);
+		}
+
+		const float farDepth{ m_pTileFarDepth[tileIdx] };
+
+		// same comparisons as TestAndWrite, so a hidden tile is one where every pixel would fail the test
+		if constexpr (Format == DepthFormat::D32Float)
+			return minDepth > farDepth;
+		else if constexpr (Format == DepthFormat::D32FloatReversed)
+			return maxDepth < farDepth;
+		else if constexpr (Format == DepthFormat::D24Unorm)
+			return EncodeUnorm(minDepth, m_D24Max) > EncodeUnorm(farDepth, m_D24Max);
+		else
+			return EncodeUnorm(minDepth, m_D16Max) > EncodeUnorm(farDepth, m_D16Max);
+	}
+
+	inline bool DepthBuffer::IsTileHidden(int tileX, int tileY, float minDepth, float maxDepth)
+	{
+		switch (m_Format)
+		{
+		case DepthFormat::D32Float:
+			return IsTileHidden<DepthFormat::D32Float>(tileX, tileY, minDepth, maxDepth);
+		case DepthFormat::D32FloatReversed:
+			return IsTileHidden<DepthFormat::D32FloatReversed>(tileX, tileY, minDepth, maxDepth);
+		case DepthFormat::D24Unorm:
+			return IsTileHidden<DepthFormat::D24Unorm>(tileX, tileY, minDepth, maxDepth);
+		case DepthFormat::D16Unorm:
+			return IsTileHidden<DepthFormat::D16Unorm>(tileX, tileY, minDepth, maxDepth);
+		}
+		return false;
+	}
+
+	inline float DepthBuffer::GetDepth(int px, int py) const
+	{
+		if (m_pTileCleared[(px >> TileShift) + (py >> TileShift) * m_TilesX])
+			return GetClearDepth();
+
+		const int pixelIdx{ px + (py * m_Width) };
+
+		switch (m_Format)
+		{
+		case DepthFormat::D32Float:
+		case DepthFormat::D32FloatReversed:
+			return reinterpret_cast<const float*>(m_pData)[pixelIdx];
+		case DepthFormat::D24Unorm:
+		{
+			const uint8_t* pDepth{ m_pData + pixelIdx * 3 };
+			const uint32_t stored{ static_cast<uint32_t>(pDepth[0]) | (static_cast<uint32_t>(pDepth[1]) << 8) | (static_cast<uint32_t>(pDepth[2]) << 16) };
+			return static_cast<float>(stored) / static_cast<float>(m_D24Max);
+		}
+		case DepthFormat::D16Unorm:
+			return static_cast<float>(reinterpret_cast<const uint16_t*>(m_pData)[pixelIdx]) / static_cast<float>(m_D16Max);
+		}
+		return 0.f;
+	}
+}
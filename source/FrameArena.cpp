@@ -0,0 +1,65 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+
+namespace dae
+{
+	FrameArena::FrameArena(size_t capacity) :
+		m_Capacity{ capacity }
+	{
+		m_pData = new uint8_t[m_Capacity];
+	}
+
+	FrameArena::~FrameArena()
+	{
+		for (uint8_t* pBlock : m_OverflowBlocks)
+		{
+			delete[] pBlock;
+		}
+		delete[] m_pData;
+		m_pData = nullptr;
+	}
+
+	void* FrameArena::Allocate(size_t size, size_t alignment)
+	{
+		const uintptr_t base{ reinterpret_cast<uintptr_t>(m_pData) };
+		const uintptr_t aligned{ (base + m_Offset + alignment - 1) & ~(alignment - 1) };
+		const size_t newOffset{ aligned - base + size };
+
+		m_UsedBytes += size;
+		m_HighWaterMark = std::max(m_HighWaterMark, m_UsedBytes);
+
+		if (newOffset <= m_Capacity)
+		{
+			m_Offset = newOffset;
+			return reinterpret_cast<void*>(aligned);
+		}
+
+		// Doesn't fit, keep the frame going with a separate block, new[] is aligned for any fundamental type
+		uint8_t* pBlock{ new uint8_t[size + alignment] };
+		m_OverflowBlocks.push_back(pBlock);
+
+		const uintptr_t blockBase{ reinterpret_cast<uintptr_t>(pBlock) };
+		return reinterpret_cast<void*>((blockBase + alignment - 1) & ~(alignment - 1));
+	}
+
+	void FrameArena::Reset()
+	{
+		m_Offset = 0;
+		m_UsedBytes = 0;
+
+		if (m_OverflowBlocks.empty())
+			return;
+
+		for (uint8_t* pBlock : m_OverflowBlocks)
+		{
+			delete[] pBlock;
+		}
+		m_OverflowBlocks.clear();
+
+		// room for the biggest frame so far plus some slack for alignment padding
+		delete[] m_pData;
+		m_Capacity = m_HighWaterMark + m_HighWaterMark / 4;
+		m_pData = new uint8_t[m_Capacity];
+	}
+}
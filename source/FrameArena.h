@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace dae
+{
+	// Linear allocator for data that only lives for one frame (transformed vertices, varyings, ...).
+	// Allocating is a pointer bump, Reset at the end of the frame releases everything at once.
+	// Not thread safe, every thread that needs transient memory gets its own arena.
+	class FrameArena final
+	{
+	public:
+		explicit FrameArena(size_t capacity);
+		~FrameArena();
+
+		FrameArena(const FrameArena&) = delete;
+		FrameArena(FrameArena&&) noexcept = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+		FrameArena& operator=(FrameArena&&) noexcept = delete;
+
+		void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+		// Value initialized, no destructors are ever run so only trivially destructible types
+		template<typename T>
+		std::span<T> Allocate(size_t count)
+		{
+			static_assert(std::is_trivially_destructible_v<T>, "arena memory is released without running destructors");
+
+			T* pData{ static_cast<T*>(Allocate(sizeof(T) * count, alignof(T))) };
+			for (size_t i{}; i < count; ++i)
+			{
+				new (pData + i) T{};
+			}
+			return { pData, count };
+		}
+
+		// Skips the value initialization, for buffers that get written before anything reads them
+		// (vertex stage outputs, render queues, ...). Reading an element that wasn't written is a bug
+		template<typename T>
+		std::span<T> AllocateUninitialized(size_t count)
+		{
+			static_assert(std::is_trivially_destructible_v<T>, "arena memory is released without running destructors");
+			static_assert(std::is_trivially_copyable_v<T>, "the elements are never constructed, only assigned");
+
+			return { static_cast<T*>(Allocate(sizeof(T) * count, alignof(T))), count };
+		}
+
+		// O(1) unless the frame didn't fit, then the block grows to the high water mark once
+		void Reset();
+
+		size_t GetUsedBytes() const { return m_UsedBytes; }
+		size_t GetCapacity() const { return m_Capacity; }
+		// largest amount of bytes a single frame needed since construction
+		size_t GetHighWaterMark() const { return m_HighWaterMark; }
+
+	private:
+		uint8_t* m_pData{ nullptr };
+		size_t m_Capacity{};
+		size_t m_Offset{};
+
+		size_t m_UsedBytes{};
+		size_t m_HighWaterMark{};
+
+		// allocations that didn't fit in the block this frame, freed at Reset
+		std::vector<uint8_t*> m_OverflowBlocks{};
+	};
+}
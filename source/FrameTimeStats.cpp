@@ -0,0 +1,152 @@
+#include "FrameTimeStats.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <fstream>
+
+namespace dae
+{
+	namespace
+	{
+		// linear interpolation between the closest ranks of sorted values
+		float GetPercentile(const std::vector<float>& sorted, float percentile)
+		{
+			const float rank{ percentile * static_cast<float>(sorted.size() - 1) };
+			const size_t lower{ static_cast<size_t>(rank) };
+			const size_t upper{ std::min(lower + 1, sorted.size() - 1) };
+			return sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - static_cast<float>(lower));
+		}
+	}
+
+	FrameTimeStats::FrameTimeStats(uint32_t windowSize) :
+		m_Window(std::max(windowSize, 1u)),
+		m_Histogram(NrBins)
+	{
+		Reset();
+	}
+
+	void FrameTimeStats::AddFrame(float seconds)
+	{
+		const float frameMs{ std::max(seconds * 1000.f, 0.f) };
+
+		m_Window[m_WindowNext] = frameMs;
+		m_WindowNext = (m_WindowNext + 1) % static_cast<uint32_t>(m_Window.size());
+		m_WindowCount = std::min(m_WindowCount + 1, static_cast<uint32_t>(m_Window.size()));
+
+		const uint32_t binIdx{ std::min(static_cast<uint32_t>(frameMs / BinWidthMs), NrBins - 1) };
+		++m_Histogram[binIdx];
+
+		++m_NrFrames;
+		m_TotalMs += frameMs;
+		m_MinMs = std::min(m_MinMs, frameMs);
+		m_MaxMs = std::max(m_MaxMs, frameMs);
+	}
+
+	void FrameTimeStats::Reset()
+	{
+		m_WindowNext = 0;
+		m_WindowCount = 0;
+		std::fill(m_Histogram.begin(), m_Histogram.end(), 0u);
+
+		m_NrFrames = 0;
+		m_TotalMs = 0.0;
+		m_MinMs = FLT_MAX;
+		m_MaxMs = 0.f;
+	}
+
+	FrameTimeStats::Summary FrameTimeStats::GetWindowSummary() const
+	{
+		if (m_WindowCount == 0)
+			return {};
+
+		// the order inside the ring doesn't matter once it's sorted
+		std::vector<float> sorted(m_Window.begin(), m_Window.begin() + m_WindowCount);
+		std::sort(sorted.begin(), sorted.end());
+
+		double totalMs{};
+		for (const float frameMs : sorted)
+			totalMs += frameMs;
+
+		Summary summary{};
+		summary.nrFrames = m_WindowCount;
+		summary.min = sorted.front();
+		summary.avg = static_cast<float>(totalMs / m_WindowCount);
+		summary.p50 = GetPercentile(sorted, 0.50f);
+		summary.p95 = GetPercentile(sorted, 0.95f);
+		summary.p99 = GetPercentile(sorted, 0.99f);
+		summary.max = sorted.back();
+		return summary;
+	}
+
+	FrameTimeStats::Summary FrameTimeStats::GetSessionSummary() const
+	{
+		if (m_NrFrames == 0)
+			return {};
+
+		Summary summary{};
+		summary.nrFrames = m_NrFrames;
+		summary.min = m_MinMs;
+		summary.avg = static_cast<float>(m_TotalMs / m_NrFrames);
+		summary.p50 = GetHistogramPercentile(0.50f);
+		summary.p95 = GetHistogramPercentile(0.95f);
+		summary.p99 = GetHistogramPercentile(0.99f);
+		summary.max = m_MaxMs;
+		return summary;
+	}
+
+	float FrameTimeStats::GetHistogramPercentile(float percentile) const
+	{
+		// frames are assumed to be spread evenly inside their bin, clamped to the real extremes
+		const float targetRank{ percentile * static_cast<float>(m_NrFrames) };
+
+		uint32_t nrBelow{};
+		for (uint32_t binIdx{}; binIdx < NrBins; ++binIdx)
+		{
+			const uint32_t binCount{ m_Histogram[binIdx] };
+			if (binCount == 0 || static_cast<float>(nrBelow + binCount) < targetRank)
+			{
+				nrBelow += binCount;
+				continue;
+			}
+
+			// the overflow bin has no upper edge
+			if (binIdx == NrBins - 1)
+				return m_MaxMs;
+
+			const float fraction{ (targetRank - static_cast<float>(nrBelow)) / static_cast<float>(binCount) };
+			return std::clamp((static_cast<float>(binIdx) + fraction) * BinWidthMs, m_MinMs, m_MaxMs);
+		}
+		return m_MaxMs;
+	}
+
+	bool FrameTimeStats::WriteCsv(const std::string& path) const
+	{
+		std::ofstream file{ path };
+		if (!file)
+			return false;
+
+		const Summary summary{ GetSessionSummary() };
+		file << "statistic,value\n"
+			<< "frames," << summary.nrFrames << "\n"
+			<< "min_ms," << summary.min << "\n"
+			<< "avg_ms," << summary.avg << "\n"
+			<< "p50_ms," << summary.p50 << "\n"
+			<< "p95_ms," << summary.p95 << "\n"
+			<< "p99_ms," << summary.p99 << "\n"
+			<< "max_ms," << summary.max << "\n"
+			<< "\n"
+			<< "bin_start_ms,bin_end_ms,frames\n";
+
+		for (uint32_t binIdx{}; binIdx < NrBins; ++binIdx)
+		{
+			if (m_Histogram[binIdx] == 0)
+				continue;
+
+			// the overflow bin ends at the slowest frame
+			const float binEnd{ binIdx == NrBins - 1 ? m_MaxMs : static_cast<float>(binIdx + 1) * BinWidthMs };
+			file << static_cast<float>(binIdx) * BinWidthMs << "," << binEnd << "," << m_Histogram[binIdx] << "\n";
+		}
+
+		return static_cast<bool>(file);
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dae
+{
+	// Frame time statistics that show stutters an average FPS hides.
+	// The last frames are kept exactly for the live percentiles, every frame since the start (or Reset)
+	// also goes into a fixed-width histogram that the session percentiles and the CSV come from.
+	class FrameTimeStats final
+	{
+	public:
+		explicit FrameTimeStats(uint32_t windowSize = 600);
+
+		FrameTimeStats(const FrameTimeStats&) = delete;
+		FrameTimeStats(FrameTimeStats&&) noexcept = delete;
+		FrameTimeStats& operator=(const FrameTimeStats&) = delete;
+		FrameTimeStats& operator=(FrameTimeStats&&) noexcept = delete;
+
+		void AddFrame(float seconds);
+		void Reset();
+
+		// all in milliseconds
+		struct Summary
+		{
+			uint32_t nrFrames{};
+			float min{};
+			float avg{};
+			float p50{};
+			float p95{};
+			float p99{};
+			float max{};
+		};
+
+		// Exact, over the last windowSize frames
+		Summary GetWindowSummary() const;
+		// Over every frame, percentiles are interpolated inside their histogram bin
+		Summary GetSessionSummary() const;
+
+		static constexpr float BinWidthMs{ 0.25f };
+		static constexpr uint32_t NrBins{ 400 };
+
+		// Frames per bin, bin i holds [i * BinWidthMs, (i + 1) * BinWidthMs), the last one everything slower
+		const std::vector<uint32_t>& GetHistogram() const { return m_Histogram; }
+
+		// Session summary followed by the histogram (empty bins left out), returns false when the file can't be written
+		bool WriteCsv(const std::string& path) const;
+
+	private:
+		// ring buffer of the most recent frame times
+		std::vector<float> m_Window{};
+		uint32_t m_WindowNext{};
+		uint32_t m_WindowCount{};
+
+		std::vector<uint32_t> m_Histogram{};
+		uint32_t m_NrFrames{};
+		double m_TotalMs{};
+		float m_MinMs{};
+		float m_MaxMs{};
+
+		float GetHistogramPercentile(float percentile) const;
+	};
+}
@@ -0,0 +1,41 @@
+#include "GBuffer.h"
+#include "DepthBuffer.h"
+
+#include <algorithm>
+
+namespace dae
+{
+	GBuffer::GBuffer(int width, int height) :
+		m_Width{ width },
+		m_Height{ height },
+		m_TilesX{ (width + DepthBuffer::TileSize - 1) / DepthBuffer::TileSize }
+	{
+		const int nrPixels{ m_Width * m_Height };
+
+		m_pUVs = new Vector2[nrPixels];
+		m_pMaterialIds = new uint8_t[nrPixels];
+		std::fill_n(m_pMaterialIds, nrPixels, InvalidMaterial);
+	}
+
+	GBuffer::~GBuffer()
+	{
+		delete[] m_pUVs;
+		m_pUVs = nullptr;
+		delete[] m_pMaterialIds;
+		m_pMaterialIds = nullptr;
+	}
+
+	void GBuffer::ClearTile(int tileIdx)
+	{
+		// only the material id needs a reset, the uv is ignored for empty pixels
+		const int tileX{ (tileIdx % m_TilesX) * DepthBuffer::TileSize };
+		const int tileY{ (tileIdx / m_TilesX) * DepthBuffer::TileSize };
+		const int tileWidth{ std::min(DepthBuffer::TileSize, m_Width - tileX) };
+		const int tileHeight{ std::min(DepthBuffer::TileSize, m_Height - tileY) };
+
+		for (int py{ tileY }; py < tileY + tileHeight; ++py)
+		{
+			std::fill_n(m_pMaterialIds + tileX + (py * m_Width), tileWidth, InvalidMaterial);
+		}
+	}
+}
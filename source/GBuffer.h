@@ -0,0 +1,46 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+
+#include "Math.h"
+
+namespace dae
+{
+	// Per-pixel surface attributes for deferred shading, depth stays in the DepthBuffer
+	class GBuffer final
+	{
+	public:
+		GBuffer(int width, int height);
+		~GBuffer();
+
+		GBuffer(const GBuffer&) = delete;
+		GBuffer(GBuffer&&) noexcept = delete;
+		GBuffer& operator=(const GBuffer&) = delete;
+		GBuffer& operator=(GBuffer&&) noexcept = delete;
+
+		// Marks every pixel of the tile as empty, uses the DepthBuffer tile grid
+		void ClearTile(int tileIdx);
+
+		void Write(int pixelIdx, const Vector2& uv, uint8_t materialId)
+		{
+			// 255 marks an empty pixel, a mesh using it would never get shaded
+			assert(materialId != InvalidMaterial);
+			m_pUVs[pixelIdx] = uv;
+			m_pMaterialIds[pixelIdx] = materialId;
+		}
+
+		// the scene only has one texture, so for now the material id just tells covered pixels apart from empty ones
+		bool IsCovered(int pixelIdx) const { return m_pMaterialIds[pixelIdx] != InvalidMaterial; }
+		const Vector2& GetUV(int pixelIdx) const { return m_pUVs[pixelIdx]; }
+
+		static constexpr uint8_t InvalidMaterial{ 0xFF };
+
+	private:
+		int m_Width{};
+		int m_Height{};
+		int m_TilesX{};
+
+		Vector2* m_pUVs{ nullptr };
+		uint8_t* m_pMaterialIds{ nullptr };
+	};
+}
@@ -1,24 +1,31 @@
 #pragma once
+#include <cassert>
+#include <cmath>
+#include <span>
+#include <xmmintrin.h>
+
+#include "MathHelpers.h"
 #include "Vector3.h"
 #include "Vector4.h"
 
 namespace dae {
-	struct Matrix
+	// Rows are 16 byte aligned so the SSE code below can load them directly
+	struct alignas(16) Matrix
 	{
 		Matrix() = default;
-		Matrix(
+		constexpr Matrix(
 			const Vector3& xAxis,
 			const Vector3& yAxis,
 			const Vector3& zAxis,
 			const Vector3& t);
 
-		Matrix(
+		constexpr Matrix(
 			const Vector4& xAxis,
 			const Vector4& yAxis,
 			const Vector4& zAxis,
 			const Vector4& t);
 
-		Matrix(const Matrix& m);
+		Matrix(const Matrix& m) = default;
 
 		Vector3 TransformVector(const Vector3& v) const;
 		Vector3 TransformVector(float x, float y, float z) const;
@@ -28,35 +35,53 @@ namespace dae {
 		Vector4 TransformPoint(const Vector4& p) const;
 		Vector4 TransformPoint(float x, float y, float z, float w) const;
 
+		// TransformPoint for a whole batch, the rows stay in registers for all of it.
+		// out needs at least as many elements as points and can't overlap it, Vector3 points get w = 1
+		void TransformPoints(std::span<const Vector3> points, std::span<Vector4> out) const;
+		void TransformPoints(std::span<const Vector4> points, std::span<Vector4> out) const;
+
 		const Matrix& Transpose();
 		const Matrix& Inverse();
+		// Inverse of a rotation + translation (orthonormal axes, no scale or projection): transposed axes
+		// and a rotated, negated translation. Much cheaper than Inverse but wrong for anything else
+		const Matrix& InverseRigid();
 
-		Vector3 GetAxisX() const;
-		Vector3 GetAxisY() const;
-		Vector3 GetAxisZ() const;
-		Vector3 GetTranslation() const;
+		constexpr Vector3 GetAxisX() const;
+		constexpr Vector3 GetAxisY() const;
+		constexpr Vector3 GetAxisZ() const;
+		constexpr Vector3 GetTranslation() const;
 
-		static Matrix CreateTranslation(float x, float y, float z);
-		static Matrix CreateTranslation(const Vector3& t);
+		static constexpr Matrix CreateTranslation(float x, float y, float z);
+		static constexpr Matrix CreateTranslation(const Vector3& t);
 		static Matrix CreateRotationX(float pitch);
 		static Matrix CreateRotationY(float yaw);
 		static Matrix CreateRotationZ(float roll);
 		static Matrix CreateRotation(float pitch, float yaw, float roll);
 		static Matrix CreateRotation(const Vector3& r);
-		static Matrix CreateScale(float sx, float sy, float sz);
-		static Matrix CreateScale(const Vector3& s);
+		static constexpr Matrix CreateScale(float sx, float sy, float sz);
+		static constexpr Matrix CreateScale(const Vector3& s);
 		static Matrix Transpose(const Matrix& m);
 		static Matrix Inverse(const Matrix& m);
+		static Matrix InverseRigid(const Matrix& m);
 
 		static Matrix CreateLookAtLH(const Vector3& origin, const Vector3& forward, const Vector3& up);
 		static Matrix CreatePerspectiveFovLH(float fovy, float aspect, float zn, float zf);
 
-		Vector4& operator[](int index);
-		Vector4 operator[](int index) const;
+		constexpr Vector4& operator[](int index);
+		constexpr Vector4 operator[](int index) const;
 		Matrix operator*(const Matrix& m) const;
 		const Matrix& operator*=(const Matrix& m);
+		// exact, element by element
+		bool operator==(const Matrix& m) const;
 
 	private:
+		static __m128 LoadRow(const Vector4& row);
+		static void StoreRow(Vector4& row, __m128 value);
+		template<int lane>
+		static __m128 Broadcast(__m128 v);
+		static __m128 Transform(__m128 x, __m128 y, __m128 z, __m128 w, __m128 row0, __m128 row1, __m128 row2, __m128 row3);
+		static __m128 Cross(__m128 a, __m128 b);
+		static float HorizontalSum(__m128 v);
 
 		//Row-Major Matrix
 		Vector4 data[4]
@@ -72,4 +97,399 @@ namespace dae {
 		// v2x v2y v2z v2w
 		// v3x v3y v3z v3w
 	};
-}
\ No newline at end of file
+
+	// Everything is defined in the header so the vertex stage can inline it without link time code generation
+	inline __m128 Matrix::LoadRow(const Vector4& row)
+	{
+		return _mm_load_ps(&row.x);
+	}
+
+	inline void Matrix::StoreRow(Vector4& row, __m128 value)
+	{
+		_mm_store_ps(&row.x, value);
+	}
+
+	template<int lane>
+	inline __m128 Matrix::Broadcast(__m128 v)
+	{
+		return _mm_shuffle_ps(v, v, _MM_SHUFFLE(lane, lane, lane, lane));
+	}
+
+	// x * row0 + y * row1 + z * row2 + w * row3, a point (row vector) times the matrix
+	inline __m128 Matrix::Transform(__m128 x, __m128 y, __m128 z, __m128 w, __m128 row0, __m128 row1, __m128 row2, __m128 row3)
+	{
+		return _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(x, row0), _mm_mul_ps(y, row1)),
+			_mm_add_ps(_mm_mul_ps(z, row2), _mm_mul_ps(w, row3)));
+	}
+
+	// xyz only, w comes out as 0
+	inline __m128 Matrix::Cross(__m128 a, __m128 b)
+	{
+		const __m128 aYzx{ _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1)) };
+		const __m128 bYzx{ _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1)) };
+		const __m128 result{ _mm_sub_ps(_mm_mul_ps(a, bYzx), _mm_mul_ps(aYzx, b)) };
+		return _mm_shuffle_ps(result, result, _MM_SHUFFLE(3, 0, 2, 1));
+	}
+
+	inline float Matrix::HorizontalSum(__m128 v)
+	{
+		const __m128 pairs{ _mm_add_ps(v, _mm_movehl_ps(v, v)) };
+		return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(1, 1, 1, 1))));
+	}
+
+	constexpr Matrix::Matrix(const Vector3& xAxis, const Vector3& yAxis, const Vector3& zAxis, const Vector3& t) :
+		Matrix({ xAxis, 0 }, { yAxis, 0 }, { zAxis, 0 }, { t, 1 })
+	{
+	}
+
+	constexpr Matrix::Matrix(const Vector4& xAxis, const Vector4& yAxis, const Vector4& zAxis, const Vector4& t)
+	{
+		data[0] = xAxis;
+		data[1] = yAxis;
+		data[2] = zAxis;
+		data[3] = t;
+	}
+
+	inline Vector3 Matrix::TransformVector(const Vector3& v) const
+	{
+		return TransformVector(v.x, v.y, v.z);
+	}
+
+	inline Vector3 Matrix::TransformVector(float x, float y, float z) const
+	{
+		alignas(16) Vector4 result;
+		StoreRow(result, Transform(_mm_set1_ps(x), _mm_set1_ps(y), _mm_set1_ps(z), _mm_setzero_ps(),
+			LoadRow(data[0]), LoadRow(data[1]), LoadRow(data[2]), LoadRow(data[3])));
+		return Vector3{ result.x, result.y, result.z };
+	}
+
+	inline Vector3 Matrix::TransformPoint(const Vector3& p) const
+	{
+		return TransformPoint(p.x, p.y, p.z);
+	}
+
+	inline Vector3 Matrix::TransformPoint(float x, float y, float z) const
+	{
+		const Vector4 result{ TransformPoint(x, y, z, 1.f) };
+		return Vector3{ result.x, result.y, result.z };
+	}
+
+	inline Vector4 Matrix::TransformPoint(const Vector4& p) const
+	{
+		return TransformPoint(p.x, p.y, p.z, p.w);
+	}
+
+	inline Vector4 Matrix::TransformPoint(float x, float y, float z, float w) const
+	{
+		alignas(16) Vector4 result;
+		StoreRow(result, Transform(_mm_set1_ps(x), _mm_set1_ps(y), _mm_set1_ps(z), _mm_set1_ps(w),
+			LoadRow(data[0]), LoadRow(data[1]), LoadRow(data[2]), LoadRow(data[3])));
+		return result;
+	}
+
+	inline void Matrix::TransformPoints(std::span<const Vector3> points, std::span<Vector4> out) const
+	{
+		assert(out.size() >= points.size());
+
+		const __m128 row0{ LoadRow(data[0]) };
+		const __m128 row1{ LoadRow(data[1]) };
+		const __m128 row2{ LoadRow(data[2]) };
+		const __m128 row3{ LoadRow(data[3]) };
+
+		for (size_t pointIdx{}; pointIdx < points.size(); ++pointIdx)
+		{
+			const Vector3& point{ points[pointIdx] };
+			const __m128 result{ _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(point.x), row0), _mm_mul_ps(_mm_set1_ps(point.y), row1)),
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(point.z), row2), row3)) };
+			_mm_storeu_ps(&out[pointIdx].x, result);
+		}
+	}
+
+	inline void Matrix::TransformPoints(std::span<const Vector4> points, std::span<Vector4> out) const
+	{
+		assert(out.size() >= points.size());
+
+		const __m128 row0{ LoadRow(data[0]) };
+		const __m128 row1{ LoadRow(data[1]) };
+		const __m128 row2{ LoadRow(data[2]) };
+		const __m128 row3{ LoadRow(data[3]) };
+
+		for (size_t pointIdx{}; pointIdx < points.size(); ++pointIdx)
+		{
+			const __m128 point{ _mm_loadu_ps(&points[pointIdx].x) };
+			_mm_storeu_ps(&out[pointIdx].x,
+				Transform(Broadcast<0>(point), Broadcast<1>(point), Broadcast<2>(point), Broadcast<3>(point), row0, row1, row2, row3));
+		}
+	}
+
+	inline const Matrix& Matrix::Transpose()
+	{
+		__m128 row0{ LoadRow(data[0]) };
+		__m128 row1{ LoadRow(data[1]) };
+		__m128 row2{ LoadRow(data[2]) };
+		__m128 row3{ LoadRow(data[3]) };
+
+		_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+
+		StoreRow(data[0], row0);
+		StoreRow(data[1], row1);
+		StoreRow(data[2], row2);
+		StoreRow(data[3], row3);
+
+		return *this;
+	}
+
+	inline const Matrix& Matrix::Inverse()
+	{
+		//Optimized Inverse as explained in FGED1 - used widely in other libraries too.
+		//a, b, c and d are the xyz of the rows, x, y, z and w their 4th elements (kept in the w lanes)
+		const __m128 a{ LoadRow(data[0]) };
+		const __m128 b{ LoadRow(data[1]) };
+		const __m128 c{ LoadRow(data[2]) };
+		const __m128 d{ LoadRow(data[3]) };
+
+		const __m128 x{ Broadcast<3>(a) };
+		const __m128 y{ Broadcast<3>(b) };
+		const __m128 z{ Broadcast<3>(c) };
+		const __m128 w{ Broadcast<3>(d) };
+
+		// every one of these has 0 in its w lane, so 4 wide dot products equal the 3 wide ones
+		__m128 s{ Cross(a, b) };
+		__m128 t{ Cross(c, d) };
+		__m128 u{ _mm_sub_ps(_mm_mul_ps(a, y), _mm_mul_ps(b, x)) };
+		__m128 v{ _mm_sub_ps(_mm_mul_ps(c, w), _mm_mul_ps(d, z)) };
+
+		const float det{ HorizontalSum(_mm_add_ps(_mm_mul_ps(s, v), _mm_mul_ps(t, u))) };
+		assert((!AreEqual(det, 0.f)) && "ERROR: determinant is 0, there is no INVERSE!");
+		const __m128 invDet{ _mm_set1_ps(1.f / det) };
+
+		s = _mm_mul_ps(s, invDet);
+		t = _mm_mul_ps(t, invDet);
+		u = _mm_mul_ps(u, invDet);
+		v = _mm_mul_ps(v, invDet);
+
+		__m128 r0{ _mm_add_ps(Cross(b, v), _mm_mul_ps(t, y)) };
+		__m128 r1{ _mm_sub_ps(Cross(v, a), _mm_mul_ps(t, x)) };
+		__m128 r2{ _mm_add_ps(Cross(d, u), _mm_mul_ps(s, w)) };
+		__m128 r3{ _mm_sub_ps(Cross(u, c), _mm_mul_ps(s, z)) };
+
+		// the r's are columns of the inverse, transposing leaves their (zero) w lanes in the last row
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+		// last row: -dot(b, t), dot(a, t), -dot(d, s), dot(c, s), the 4 dot products get summed with a transpose as well
+		__m128 bt{ _mm_mul_ps(b, t) };
+		__m128 at{ _mm_mul_ps(a, t) };
+		__m128 ds{ _mm_mul_ps(d, s) };
+		__m128 cs{ _mm_mul_ps(c, s) };
+		_MM_TRANSPOSE4_PS(bt, at, ds, cs);
+		const __m128 dots{ _mm_add_ps(_mm_add_ps(bt, at), _mm_add_ps(ds, cs)) };
+
+		StoreRow(data[0], r0);
+		StoreRow(data[1], r1);
+		StoreRow(data[2], r2);
+		StoreRow(data[3], _mm_mul_ps(dots, _mm_setr_ps(-1.f, 1.f, -1.f, 1.f)));
+
+		return *this;
+	}
+
+	inline const Matrix& Matrix::InverseRigid()
+	{
+		assert(AreEqual(data[0].w, 0.f) && AreEqual(data[1].w, 0.f) && AreEqual(data[2].w, 0.f) && AreEqual(data[3].w, 1.f) && "ERROR: not a rigid transform");
+
+		// the axes become the columns, the zero row transposes into the (still zero) w lanes
+		__m128 r0{ LoadRow(data[0]) };
+		__m128 r1{ LoadRow(data[1]) };
+		__m128 r2{ LoadRow(data[2]) };
+		__m128 r3{ _mm_setzero_ps() };
+		const __m128 t{ LoadRow(data[3]) };
+
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+		// -t expressed in the transposed axes, w = 1
+		const __m128 translation{ Transform(Broadcast<0>(t), Broadcast<1>(t), Broadcast<2>(t), _mm_setzero_ps(), r0, r1, r2, r3) };
+
+		StoreRow(data[0], r0);
+		StoreRow(data[1], r1);
+		StoreRow(data[2], r2);
+		StoreRow(data[3], _mm_sub_ps(_mm_setr_ps(0.f, 0.f, 0.f, 1.f), translation));
+
+		return *this;
+	}
+
+	inline Matrix Matrix::Transpose(const Matrix& m)
+	{
+		Matrix out{ m };
+		out.Transpose();
+
+		return out;
+	}
+
+	inline Matrix Matrix::Inverse(const Matrix& m)
+	{
+		Matrix out{ m };
+		out.Inverse();
+
+		return out;
+	}
+
+	inline Matrix Matrix::InverseRigid(const Matrix& m)
+	{
+		Matrix out{ m };
+		out.InverseRigid();
+
+		return out;
+	}
+
+	// https://learn.microsoft.com/en-us/windows/win32/direct3d9/d3dxmatrixlookatlh, with a direction instead of a target
+	inline Matrix Matrix::CreateLookAtLH(const Vector3& origin, const Vector3& forward, const Vector3& up)
+	{
+		const Vector3 zAxis{ forward.Normalized() };
+		const Vector3 xAxis{ Vector3::Cross(up, zAxis).Normalized() };
+		const Vector3 yAxis{ Vector3::Cross(zAxis, xAxis) };
+
+		// the axes are orthonormal, so the rigid inverse of the camera's world matrix is enough
+		return InverseRigid(Matrix{ xAxis, yAxis, zAxis, origin });
+	}
+
+	// https://learn.microsoft.com/en-us/windows/win32/direct3d9/d3dxmatrixperspectivefovlh, fov in radians.
+	// Swapping zn and zf gives the reversed-Z matrix
+	inline Matrix Matrix::CreatePerspectiveFovLH(float fov, float aspect, float zn, float zf)
+	{
+		const float yScale{ 1.f / std::tan(fov / 2.f) };
+		const float xScale{ yScale / aspect };
+
+		return Matrix{
+			Vector4{ xScale, 0.f, 0.f, 0.f },
+			Vector4{ 0.f, yScale, 0.f, 0.f },
+			Vector4{ 0.f, 0.f, zf / (zf - zn), 1.f },
+			Vector4{ 0.f, 0.f, -zn * zf / (zf - zn), 0.f } };
+	}
+
+	constexpr Vector3 Matrix::GetAxisX() const
+	{
+		return data[0];
+	}
+
+	constexpr Vector3 Matrix::GetAxisY() const
+	{
+		return data[1];
+	}
+
+	constexpr Vector3 Matrix::GetAxisZ() const
+	{
+		return data[2];
+	}
+
+	constexpr Vector3 Matrix::GetTranslation() const
+	{
+		return data[3];
+	}
+
+	constexpr Matrix Matrix::CreateTranslation(float x, float y, float z)
+	{
+		return CreateTranslation({ x, y, z });
+	}
+
+	constexpr Matrix Matrix::CreateTranslation(const Vector3& t)
+	{
+		return { Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, t };
+	}
+
+	inline Matrix Matrix::CreateRotationX(float pitch)
+	{
+		return {
+			{1, 0, 0, 0},
+			{0, std::cos(pitch), -std::sin(pitch), 0},
+			{0, std::sin(pitch), std::cos(pitch), 0},
+			{0, 0, 0, 1}
+		};
+	}
+
+	inline Matrix Matrix::CreateRotationY(float yaw)
+	{
+		return {
+			{std::cos(yaw), 0, -std::sin(yaw), 0},
+			{0, 1, 0, 0},
+			{std::sin(yaw), 0, std::cos(yaw), 0},
+			{0, 0, 0, 1}
+		};
+	}
+
+	inline Matrix Matrix::CreateRotationZ(float roll)
+	{
+		return {
+			{std::cos(roll), std::sin(roll), 0, 0},
+			{-std::sin(roll), std::cos(roll), 0, 0},
+			{0, 0, 1, 0},
+			{0, 0, 0, 1}
+		};
+	}
+
+	inline Matrix Matrix::CreateRotation(float pitch, float yaw, float roll)
+	{
+		return CreateRotation({ pitch, yaw, roll });
+	}
+
+	inline Matrix Matrix::CreateRotation(const Vector3& r)
+	{
+		return CreateRotationX(r[0]) * CreateRotationY(r[1]) * CreateRotationZ(r[2]);
+	}
+
+	constexpr Matrix Matrix::CreateScale(float sx, float sy, float sz)
+	{
+		return { {sx, 0, 0}, {0, sy, 0}, {0, 0, sz}, Vector3::Zero };
+	}
+
+	constexpr Matrix Matrix::CreateScale(const Vector3& s)
+	{
+		return CreateScale(s[0], s[1], s[2]);
+	}
+
+#pragma region Operator Overloads
+	constexpr Vector4& Matrix::operator[](int index)
+	{
+		assert(index <= 3 && index >= 0);
+		return data[index];
+	}
+
+	constexpr Vector4 Matrix::operator[](int index) const
+	{
+		assert(index <= 3 && index >= 0);
+		return data[index];
+	}
+
+	inline Matrix Matrix::operator*(const Matrix& m) const
+	{
+		// row r of the result is row r of this matrix transforming m, no transposed copy needed
+		const __m128 row0{ LoadRow(m.data[0]) };
+		const __m128 row1{ LoadRow(m.data[1]) };
+		const __m128 row2{ LoadRow(m.data[2]) };
+		const __m128 row3{ LoadRow(m.data[3]) };
+
+		Matrix result;
+		for (int r{ 0 }; r < 4; ++r)
+		{
+			const __m128 row{ LoadRow(data[r]) };
+			StoreRow(result.data[r], Transform(Broadcast<0>(row), Broadcast<1>(row), Broadcast<2>(row), Broadcast<3>(row), row0, row1, row2, row3));
+		}
+
+		return result;
+	}
+
+	inline const Matrix& Matrix::operator*=(const Matrix& m)
+	{
+		*this = *this * m;
+		return *this;
+	}
+
+	inline bool Matrix::operator==(const Matrix& m) const
+	{
+		const __m128 equal{ _mm_and_ps(
+			_mm_and_ps(_mm_cmpeq_ps(LoadRow(data[0]), LoadRow(m.data[0])), _mm_cmpeq_ps(LoadRow(data[1]), LoadRow(m.data[1]))),
+			_mm_and_ps(_mm_cmpeq_ps(LoadRow(data[2]), LoadRow(m.data[2])), _mm_cmpeq_ps(LoadRow(data[3]), LoadRow(m.data[3])))) };
+		return _mm_movemask_ps(equal) == 0xF;
+	}
+#pragma endregion
+}
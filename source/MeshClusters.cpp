@@ -0,0 +1,267 @@
+#include "MeshClusters.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace dae
+{
+	namespace
+	{
+		// Spreads the low 10 bits so three of them interleave into a 30-bit morton code
+		uint32_t SpreadBits(uint32_t value)
+		{
+			value &= 0x3FF;
+			value = (value | (value << 16)) & 0x030000FF;
+			value = (value | (value << 8)) & 0x0300F00F;
+			value = (value | (value << 4)) & 0x030C30C3;
+			value = (value | (value << 2)) & 0x09249249;
+			return value;
+		}
+
+		// Orders the triangles of a list by the axis their normal mostly points along (6 buckets),
+		// then along a morton curve of their centroid within the mesh bounds
+		void SortTrianglesForClustering(Mesh& mesh)
+		{
+			const size_t nrTriangles{ mesh.indices.size() / 3 };
+
+			Vector3 min{ mesh.vertices[mesh.indices[0]].position };
+			Vector3 max{ min };
+			for (const uint32_t vertexIdx : mesh.indices)
+			{
+				const Vector3& position{ mesh.vertices[vertexIdx].position };
+				min = Vector3{ std::min(min.x, position.x), std::min(min.y, position.y), std::min(min.z, position.z) };
+				max = Vector3{ std::max(max.x, position.x), std::max(max.y, position.y), std::max(max.z, position.z) };
+			}
+			const Vector3 extent{ max - min };
+
+			std::vector<std::pair<uint64_t, uint32_t>> keys(nrTriangles);
+			for (size_t triangleIdx{}; triangleIdx < nrTriangles; ++triangleIdx)
+			{
+				const Vector3& position0{ mesh.vertices[mesh.indices[triangleIdx * 3]].position };
+				const Vector3& position1{ mesh.vertices[mesh.indices[triangleIdx * 3 + 1]].position };
+				const Vector3& position2{ mesh.vertices[mesh.indices[triangleIdx * 3 + 2]].position };
+
+				const Vector3 normal{ Vector3::Cross(position1 - position0, position2 - position0) };
+				int axis{ std::abs(normal.x) >= std::abs(normal.y) ? 0 : 1 };
+				if (std::abs(normal.z) > std::abs(normal[axis]))
+					axis = 2;
+				const uint64_t bucket{ static_cast<uint64_t>(axis * 2 + (normal[axis] < 0.f)) };
+
+				const Vector3 centroid{ (position0 + position1 + position2) / 3.f };
+				uint32_t morton{};
+				for (int i{}; i < 3; ++i)
+				{
+					const float normalized{ extent[i] > 0.f ? (centroid[i] - min[i]) / extent[i] : 0.f };
+					morton |= SpreadBits(static_cast<uint32_t>(Saturate(normalized) * 1023.f)) << i;
+				}
+
+				keys[triangleIdx] = { (bucket << 32) | morton, static_cast<uint32_t>(triangleIdx) };
+			}
+
+			std::sort(keys.begin(), keys.end());
+
+			std::vector<uint32_t> sortedIndices{};
+			sortedIndices.reserve(nrTriangles * 3);
+			for (const auto& key : keys)
+			{
+				sortedIndices.insert(sortedIndices.end(), mesh.indices.begin() + key.second * 3, mesh.indices.begin() + key.second * 3 + 3);
+			}
+			mesh.indices = std::move(sortedIndices);
+		}
+
+		void FinishCluster(Mesh& mesh, MeshCluster& cluster)
+		{
+			const uint32_t* pVertexIndices{ mesh.clusterVertexIndices.data() + cluster.firstVertex };
+
+			// Bounding sphere around the centroid
+			Vector3 center{};
+			for (uint32_t i{}; i < cluster.vertexCount; ++i)
+			{
+				center += mesh.vertices[pVertexIndices[i]].position;
+			}
+			center /= static_cast<float>(cluster.vertexCount);
+
+			float radius{};
+			for (uint32_t i{}; i < cluster.vertexCount; ++i)
+			{
+				radius = std::max(radius, (mesh.vertices[pVertexIndices[i]].position - center).Magnitude());
+			}
+
+			cluster.boundsCenter = center;
+			cluster.boundsRadius = radius;
+
+			// Normal cone, the winding the rasterizer accepts gives normals that point towards the camera
+			Vector3 normals[MaxClusterTriangles]{};
+			uint32_t nrNormals{};
+			Vector3 axis{};
+			for (uint32_t triangleIdx{ cluster.firstTriangle }; triangleIdx < cluster.firstTriangle + cluster.triangleCount; ++triangleIdx)
+			{
+				const size_t vertIdx{ GetTriangleIndexOffset(mesh, triangleIdx) };
+				const bool swapVerts{ mesh.primitiveTopology == PrimitiveTopology::TriangleStrip && triangleIdx % 2 };
+
+				const Vector3& position0{ mesh.vertices[mesh.indices[vertIdx + swapVerts * 2]].position };
+				const Vector3& position1{ mesh.vertices[mesh.indices[vertIdx + 1]].position };
+				const Vector3& position2{ mesh.vertices[mesh.indices[vertIdx + !swapVerts * 2]].position };
+
+				Vector3 normal{ Vector3::Cross(position1 - position0, position2 - position0) };
+				// degenerate (strip restarts), never rasterized so they don't widen the cone
+				if (normal.Normalize() <= 0.f)
+					continue;
+
+				normals[nrNormals++] = normal;
+				axis += normal;
+			}
+
+			// cutoff of -1 never culls, for clusters that have no usable normals
+			cluster.coneAxis = Vector3::UnitZ;
+			cluster.coneCutoff = -1.f;
+			if (nrNormals == 0 || axis.Normalize() <= 0.f)
+				return;
+
+			float minDot{ 1.f };
+			for (uint32_t i{}; i < nrNormals; ++i)
+			{
+				minDot = std::min(minDot, Vector3::Dot(axis, normals[i]));
+			}
+
+			cluster.coneAxis = axis;
+			cluster.coneCutoff = minDot;
+		}
+	}
+
+	void BuildClusters(Mesh& mesh)
+	{
+		mesh.clusters.clear();
+		mesh.clusterVertexIndices.clear();
+
+		const size_t nrTriangles{ GetTriangleCount(mesh) };
+		if (nrTriangles == 0)
+			return;
+
+		// Whole mesh bounds, sphere around the center of the AABB
+		Vector3 min{ mesh.vertices[0].position };
+		Vector3 max{ min };
+		for (const Vertex& vertex : mesh.vertices)
+		{
+			min = Vector3{ std::min(min.x, vertex.position.x), std::min(min.y, vertex.position.y), std::min(min.z, vertex.position.z) };
+			max = Vector3{ std::max(max.x, vertex.position.x), std::max(max.y, vertex.position.y), std::max(max.z, vertex.position.z) };
+		}
+
+		mesh.boundsCenter = (min + max) * 0.5f;
+		mesh.boundsRadius = 0.f;
+		for (const Vertex& vertex : mesh.vertices)
+		{
+			mesh.boundsRadius = std::max(mesh.boundsRadius, (vertex.position - mesh.boundsCenter).Magnitude());
+		}
+
+		// Strips have to stay in order, lists get regrouped first so clusters are tight and face one way
+		if (mesh.primitiveTopology == PrimitiveTopology::TriangleList)
+			SortTrianglesForClustering(mesh);
+
+		MeshCluster cluster{};
+
+		for (size_t triangleIdx{}; triangleIdx < nrTriangles; ++triangleIdx)
+		{
+			const size_t vertIdx{ GetTriangleIndexOffset(mesh, triangleIdx) };
+			const uint32_t triangleVertices[3]{ mesh.indices[vertIdx], mesh.indices[vertIdx + 1], mesh.indices[vertIdx + 2] };
+
+			// unique vertices this triangle would add to the cluster
+			const uint32_t* pClusterVertices{ mesh.clusterVertexIndices.data() + cluster.firstVertex };
+			uint32_t newVertices[3]{};
+			uint32_t nrNewVertices{};
+			for (const uint32_t vertexIdx : triangleVertices)
+			{
+				if (std::find(pClusterVertices, pClusterVertices + cluster.vertexCount, vertexIdx) != pClusterVertices + cluster.vertexCount)
+					continue;
+				if (std::find(newVertices, newVertices + nrNewVertices, vertexIdx) != newVertices + nrNewVertices)
+					continue;
+				newVertices[nrNewVertices++] = vertexIdx;
+			}
+
+			if (cluster.triangleCount == MaxClusterTriangles || cluster.vertexCount + nrNewVertices > MaxClusterVertices)
+			{
+				FinishCluster(mesh, cluster);
+				mesh.clusters.push_back(cluster);
+
+				cluster = MeshCluster{};
+				cluster.firstTriangle = static_cast<uint32_t>(triangleIdx);
+				cluster.firstVertex = static_cast<uint32_t>(mesh.clusterVertexIndices.size());
+
+				// everything is new in an empty cluster
+				nrNewVertices = 0;
+				for (const uint32_t vertexIdx : triangleVertices)
+				{
+					if (std::find(newVertices, newVertices + nrNewVertices, vertexIdx) == newVertices + nrNewVertices)
+						newVertices[nrNewVertices++] = vertexIdx;
+				}
+			}
+
+			mesh.clusterVertexIndices.insert(mesh.clusterVertexIndices.end(), newVertices, newVertices + nrNewVertices);
+			cluster.vertexCount += nrNewVertices;
+			++cluster.triangleCount;
+		}
+
+		FinishCluster(mesh, cluster);
+		mesh.clusters.push_back(cluster);
+	}
+
+	ClusterCuller::ClusterCuller(const Matrix& worldViewProjection, const Matrix& worldMatrix, const Vector3& cameraPosition) :
+		m_CameraPosition{ Matrix::Inverse(worldMatrix).TransformPoint(cameraPosition) }
+	{
+		// Planes straight from the clip space conditions (-w <= x <= w, -w <= y <= w, 0 <= z <= w),
+		// with the world matrix included they end up in object space
+		const Matrix& m{ worldViewProjection };
+		const Vector4 column0{ m[0].x, m[1].x, m[2].x, m[3].x };
+		const Vector4 column1{ m[0].y, m[1].y, m[2].y, m[3].y };
+		const Vector4 column2{ m[0].z, m[1].z, m[2].z, m[3].z };
+		const Vector4 column3{ m[0].w, m[1].w, m[2].w, m[3].w };
+
+		m_FrustumPlanes[0] = column3 + column0;
+		m_FrustumPlanes[1] = column3 - column0;
+		m_FrustumPlanes[2] = column3 + column1;
+		m_FrustumPlanes[3] = column3 - column1;
+		m_FrustumPlanes[4] = column2;
+		m_FrustumPlanes[5] = column3 - column2;
+
+		for (Vector4& plane : m_FrustumPlanes)
+		{
+			const float length{ Vector3{ plane.x, plane.y, plane.z }.Magnitude() };
+			plane = plane * (1.f / length);
+		}
+	}
+
+	bool ClusterCuller::IsVisible(const MeshCluster& cluster) const
+	{
+		const Vector3& center{ cluster.boundsCenter };
+		const float radius{ cluster.boundsRadius };
+
+		for (const Vector4& plane : m_FrustumPlanes)
+		{
+			if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius)
+				return false;
+		}
+
+		// Backfacing as a whole when even the normal closest to the view direction points away:
+		// angle(view, axis) + cone angle + angular radius of the sphere has to stay below 90 degrees
+		if (cluster.coneCutoff <= 0.f)
+			return true;
+
+		const Vector3 toCenter{ center - m_CameraPosition };
+		const float distance{ toCenter.Magnitude() };
+		if (distance <= radius)
+			return true;
+
+		const float cosCone{ cluster.coneCutoff };
+		const float sinCone{ std::sqrt(1.f - cosCone * cosCone) };
+		const float sinSphere{ radius / distance };
+		const float cosSphere{ std::sqrt(1.f - sinSphere * sinSphere) };
+
+		if (cosCone * cosSphere - sinCone * sinSphere <= 0.f)
+			return true;
+
+		const float sinLimit{ sinCone * cosSphere + cosCone * sinSphere };
+		return Vector3::Dot(toCenter, cluster.coneAxis) <= sinLimit * distance;
+	}
+}
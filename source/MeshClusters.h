@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	static constexpr uint32_t MaxClusterTriangles{ 64 };
+	// 3 per triangle, meshes that don't share vertices (like the OBJ parser output) still fill a cluster
+	static constexpr uint32_t MaxClusterVertices{ 192 };
+
+	// Splits the mesh in clusters of consecutive triangles (at most MaxClusterTriangles triangles
+	// and MaxClusterVertices unique vertices each) with a bounding sphere and a normal cone, done at load.
+	// Triangle lists get reordered first so a cluster's triangles are close together and face the same way.
+	void BuildClusters(Mesh& mesh);
+
+	inline size_t GetTriangleCount(const Mesh& mesh)
+	{
+		if (mesh.primitiveTopology == PrimitiveTopology::TriangleStrip)
+			return mesh.indices.size() >= 3 ? mesh.indices.size() - 2 : 0;
+
+		return mesh.indices.size() / 3;
+	}
+
+	// Position of the triangle's first index in mesh.indices, what RenderTrianglesMesh calls vertIdx
+	inline size_t GetTriangleIndexOffset(const Mesh& mesh, size_t triangleIdx)
+	{
+		return mesh.primitiveTopology == PrimitiveTopology::TriangleStrip ? triangleIdx : triangleIdx * 3;
+	}
+
+	// Culls clusters against the view frustum (bounding sphere) and as a whole when every triangle
+	// faces away from the camera (normal cone), everything in the mesh's object space
+	class ClusterCuller final
+	{
+	public:
+		ClusterCuller(const Matrix& worldViewProjection, const Matrix& worldMatrix, const Vector3& cameraPosition);
+
+		bool IsVisible(const MeshCluster& cluster) const;
+
+	private:
+		// left, right, bottom, top, near, far with normalized normals pointing inside
+		Vector4 m_FrustumPlanes[6]{};
+		Vector3 m_CameraPosition{};
+	};
+}
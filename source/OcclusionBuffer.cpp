@@ -0,0 +1,222 @@
+#include "OcclusionBuffer.h"
+#include "PlaneEquation.h"
+
+#include <algorithm>
+
+namespace dae
+{
+	OcclusionBuffer::OcclusionBuffer(int width, int height) :
+		m_Width{ width },
+		m_Height{ height }
+	{
+		while (m_NrLevels < MaxLevels)
+		{
+			const int nrTexels{ GetLevelWidth(m_NrLevels) * GetLevelHeight(m_NrLevels) };
+			m_pMinLevels[m_NrLevels] = new float[nrTexels];
+			m_pMaxLevels[m_NrLevels] = new float[nrTexels];
+			++m_NrLevels;
+
+			if (nrTexels == 1)
+				break;
+		}
+	}
+
+	OcclusionBuffer::~OcclusionBuffer()
+	{
+		for (int level{}; level < m_NrLevels; ++level)
+		{
+			delete[] m_pMinLevels[level];
+			m_pMinLevels[level] = nullptr;
+			delete[] m_pMaxLevels[level];
+			m_pMaxLevels[level] = nullptr;
+		}
+	}
+
+	void OcclusionBuffer::Clear(bool isReversedZ)
+	{
+		m_IsReversedZ = isReversedZ;
+		std::fill_n(m_pMinLevels[0], m_Width * m_Height, FLT_MAX);
+		std::fill_n(m_pMaxLevels[0], m_Width * m_Height, FLT_MAX);
+	}
+
+	void OcclusionBuffer::RasterizeTriangle(const Vector4& clip0, const Vector4& clip1, const Vector4& clip2)
+	{
+		if (clip0.w <= 0.f || clip1.w <= 0.f || clip2.w <= 0.f)
+			return;
+
+		// texel (x, y) spans [x, x + 1] in these coordinates, so the corners are at integers
+		const auto toScreen = [this](const Vector4& clip)
+		{
+			return Vector2{
+				(clip.x / clip.w + 1.f) * 0.5f * static_cast<float>(m_Width),
+				(1.f - clip.y / clip.w) * 0.5f * static_cast<float>(m_Height)
+			};
+		};
+
+		Vector2 position0{ toScreen(clip0) };
+		Vector2 position1{ toScreen(clip1) };
+		const Vector2 position2{ toScreen(clip2) };
+		float distance0{ ToDistance(clip0.z / clip0.w) };
+		float distance1{ ToDistance(clip1.z / clip1.w) };
+		const float distance2{ ToDistance(clip2.z / clip2.w) };
+
+		// occluders count from both sides, make the winding consistent
+		float area{ Vector2::Cross(position1 - position0, position2 - position0) };
+		if (area < 0.f)
+		{
+			std::swap(position0, position1);
+			std::swap(distance0, distance1);
+			area = -area;
+		}
+		if (area <= 0.f)
+			return;
+
+		// texel centers sit at x + 0.5, y + 0.5
+		const int minX{ std::max(static_cast<int>(std::ceil(std::min({ position0.x, position1.x, position2.x }) - 0.5f)), 0) };
+		const int maxX{ std::min(static_cast<int>(std::floor(std::max({ position0.x, position1.x, position2.x }) - 0.5f)), m_Width - 1) };
+		const int minY{ std::max(static_cast<int>(std::ceil(std::min({ position0.y, position1.y, position2.y }) - 0.5f)), 0) };
+		const int maxY{ std::min(static_cast<int>(std::floor(std::max({ position0.y, position1.y, position2.y }) - 0.5f)), m_Height - 1) };
+		if (minX > maxX || minY > maxY)
+			return;
+
+		const TrianglePlaneSetup planeSetup{ position0, position1, position2 };
+		const PlaneEquation distancePlane{ planeSetup.Create(distance0, distance1, distance2) };
+
+		// depth is linear, so the farthest point of a texel is the corner the plane slopes away to
+		const float cornerOffset{ 0.5f * (std::abs(distancePlane.dx) + std::abs(distancePlane.dy)) };
+
+		// edge functions at the first texel center, stepped incrementally. Shared edges count for both
+		// triangles, which is fine since overlapping writes are min-combined
+		const Vector2 edges[3]{ position1 - position0, position2 - position1, position0 - position2 };
+		const Vector2 origins[3]{ position0, position1, position2 };
+		const Vector2 firstCenter{ static_cast<float>(minX) + 0.5f, static_cast<float>(minY) + 0.5f };
+
+		float rowEdges[3]{};
+		for (int edgeIdx{}; edgeIdx < 3; ++edgeIdx)
+		{
+			rowEdges[edgeIdx] = Vector2::Cross(edges[edgeIdx], firstCenter - origins[edgeIdx]);
+		}
+
+		float* pDepth{ m_pMaxLevels[0] };
+		for (int y{ minY }; y <= maxY; ++y)
+		{
+			float edge0{ rowEdges[0] };
+			float edge1{ rowEdges[1] };
+			float edge2{ rowEdges[2] };
+			float farthest{ distancePlane.Evaluate(firstCenter.x, static_cast<float>(y) + 0.5f) + cornerOffset };
+
+			for (int x{ minX }; x <= maxX; ++x)
+			{
+				if (edge0 >= 0.f && edge1 >= 0.f && edge2 >= 0.f)
+				{
+					float& stored{ pDepth[x + y * m_Width] };
+					stored = std::min(stored, farthest);
+				}
+
+				edge0 -= edges[0].y;
+				edge1 -= edges[1].y;
+				edge2 -= edges[2].y;
+				farthest += distancePlane.dx;
+			}
+
+			rowEdges[0] += edges[0].x;
+			rowEdges[1] += edges[1].x;
+			rowEdges[2] += edges[2].x;
+		}
+	}
+
+	void OcclusionBuffer::BuildPyramid()
+	{
+		// Coverage is sampled at texel centers, so a texel on the silhouette of the occluders can be partly empty.
+		// Eroding by one texel (the farthest of the 3x3 neighbourhood) only keeps texels that are surrounded
+		// by covered ones. Level 0 min keeps the rasterized values, the tests only use the max levels
+		float* pRasterized{ m_pMinLevels[0] };
+		std::copy_n(m_pMaxLevels[0], m_Width * m_Height, pRasterized);
+
+		for (int y{}; y < m_Height; ++y)
+		{
+			for (int x{}; x < m_Width; ++x)
+			{
+				float farthest{ 0.f };
+				for (int neighbourY{ std::max(y - 1, 0) }; neighbourY <= std::min(y + 1, m_Height - 1); ++neighbourY)
+				{
+					for (int neighbourX{ std::max(x - 1, 0) }; neighbourX <= std::min(x + 1, m_Width - 1); ++neighbourX)
+					{
+						farthest = std::max(farthest, pRasterized[neighbourX + neighbourY * m_Width]);
+					}
+				}
+
+				m_pMaxLevels[0][x + y * m_Width] = farthest;
+			}
+		}
+
+		for (int level{ 1 }; level < m_NrLevels; ++level)
+		{
+			const int width{ GetLevelWidth(level) };
+			const int height{ GetLevelHeight(level) };
+			const int parentWidth{ GetLevelWidth(level - 1) };
+			const int parentHeight{ GetLevelHeight(level - 1) };
+
+			for (int y{}; y < height; ++y)
+			{
+				for (int x{}; x < width; ++x)
+				{
+					// odd parents get their last row/column folded into the last texel
+					const int firstX{ x * 2 };
+					const int firstY{ y * 2 };
+					const int lastX{ x == width - 1 ? parentWidth - 1 : firstX + 1 };
+					const int lastY{ y == height - 1 ? parentHeight - 1 : firstY + 1 };
+
+					float minDistance{ FLT_MAX };
+					float maxDistance{ 0.f };
+					for (int parentY{ firstY }; parentY <= lastY; ++parentY)
+					{
+						for (int parentX{ firstX }; parentX <= lastX; ++parentX)
+						{
+							minDistance = std::min(minDistance, m_pMinLevels[level - 1][parentX + parentY * parentWidth]);
+							maxDistance = std::max(maxDistance, m_pMaxLevels[level - 1][parentX + parentY * parentWidth]);
+						}
+					}
+
+					m_pMinLevels[level][x + y * width] = minDistance;
+					m_pMaxLevels[level][x + y * width] = maxDistance;
+				}
+			}
+		}
+	}
+
+	bool OcclusionBuffer::IsOccluded(const Vector2& ndcMin, const Vector2& ndcMax, float nearestDepth) const
+	{
+		const float nearestDistance{ ToDistance(nearestDepth) };
+
+		// NDC y points up, texel rows go down
+		const float left{ (ndcMin.x + 1.f) * 0.5f * static_cast<float>(m_Width) };
+		const float right{ (ndcMax.x + 1.f) * 0.5f * static_cast<float>(m_Width) };
+		const float top{ (1.f - ndcMax.y) * 0.5f * static_cast<float>(m_Height) };
+		const float bottom{ (1.f - ndcMin.y) * 0.5f * static_cast<float>(m_Height) };
+
+		const int minX{ std::clamp(static_cast<int>(std::floor(left)), 0, m_Width - 1) };
+		const int maxX{ std::clamp(static_cast<int>(std::floor(right)), 0, m_Width - 1) };
+		const int minY{ std::clamp(static_cast<int>(std::floor(top)), 0, m_Height - 1) };
+		const int maxY{ std::clamp(static_cast<int>(std::floor(bottom)), 0, m_Height - 1) };
+
+		// the level where the box covers at most 2x2 texels
+		int level{};
+		while (level < m_NrLevels - 1 && ((maxX >> level) - (minX >> level) > 1 || (maxY >> level) - (minY >> level) > 1))
+			++level;
+
+		const int levelWidth{ GetLevelWidth(level) };
+		const int levelHeight{ GetLevelHeight(level) };
+		for (int y{ std::min(minY >> level, levelHeight - 1) }; y <= std::min(maxY >> level, levelHeight - 1); ++y)
+		{
+			for (int x{ std::min(minX >> level, levelWidth - 1) }; x <= std::min(maxX >> level, levelWidth - 1); ++x)
+			{
+				// visible as soon as the box could be in front of the farthest occluder depth of one texel
+				if (nearestDistance <= m_pMaxLevels[level][x + y * levelWidth])
+					return false;
+			}
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+
+#include "Math.h"
+
+namespace dae
+{
+	// Low resolution depth buffer of the designated occluders, reduced to a min/max depth pyramid
+	// that bounds get tested against before the main pass.
+	// Depth is stored as a "distance" that grows away from the camera, reversed-z gets flipped on the way in.
+	class OcclusionBuffer final
+	{
+	public:
+		OcclusionBuffer(int width, int height);
+		~OcclusionBuffer();
+
+		OcclusionBuffer(const OcclusionBuffer&) = delete;
+		OcclusionBuffer(OcclusionBuffer&&) noexcept = delete;
+		OcclusionBuffer& operator=(const OcclusionBuffer&) = delete;
+		OcclusionBuffer& operator=(OcclusionBuffer&&) noexcept = delete;
+
+		void Clear(bool isReversedZ);
+
+		// Positions in clip space. Texels get written with the farthest depth inside the texel, coverage gets
+		// made conservative when building the pyramid.
+		// Triangles crossing the near plane are skipped, which only loses occlusion.
+		void RasterizeTriangle(const Vector4& clip0, const Vector4& clip1, const Vector4& clip2);
+
+		void BuildPyramid();
+
+		// Box in NDC (x, y in [-1, 1]) and the nearest device depth inside it
+		bool IsOccluded(const Vector2& ndcMin, const Vector2& ndcMax, float nearestDepth) const;
+
+		int GetWidth() const { return m_Width; }
+		int GetHeight() const { return m_Height; }
+
+		float GetMinDepth(int level, int x, int y) const { return m_pMinLevels[level][x + y * GetLevelWidth(level)]; }
+		float GetMaxDepth(int level, int x, int y) const { return m_pMaxLevels[level][x + y * GetLevelWidth(level)]; }
+
+	private:
+		static constexpr int MaxLevels{ 16 };
+
+		int m_Width{};
+		int m_Height{};
+		int m_NrLevels{};
+		bool m_IsReversedZ{};
+
+		// level 0 is the rasterized buffer, every next level halves the resolution
+		float* m_pMinLevels[MaxLevels]{};
+		float* m_pMaxLevels[MaxLevels]{};
+
+		int GetLevelWidth(int level) const { return std::max(m_Width >> level, 1); }
+		int GetLevelHeight(int level) const { return std::max(m_Height >> level, 1); }
+
+		float ToDistance(float depth) const { return m_IsReversedZ ? 1.f - depth : depth; }
+	};
+}
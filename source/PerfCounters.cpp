@@ -0,0 +1,184 @@
+#include "PerfCounters.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace dae
+{
+#ifdef __linux__
+	namespace
+	{
+		struct CounterConfig
+		{
+			uint32_t type;
+			uint64_t config;
+		};
+
+		// same order as PerfCounter, the first one leads the group
+		constexpr CounterConfig g_CounterConfigs[NrPerfCounters]{
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+			{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+		};
+
+		// One counter group per thread, so all counters of a read cover exactly the same instructions
+		class ThreadCounters final
+		{
+		public:
+			ThreadCounters()
+			{
+				for (int counterIdx{}; counterIdx < NrPerfCounters; ++counterIdx)
+				{
+					perf_event_attr attributes{};
+					attributes.size = sizeof(perf_event_attr);
+					attributes.type = g_CounterConfigs[counterIdx].type;
+					attributes.config = g_CounterConfigs[counterIdx].config;
+					attributes.disabled = counterIdx == 0 ? 1 : 0;
+					// user space only, that's all perf_event_paranoid 2 allows and all the renderer runs
+					attributes.exclude_kernel = 1;
+					attributes.exclude_hv = 1;
+					attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
+
+					// pid 0 and cpu -1: this thread, on whatever core it runs
+					const int groupFd{ counterIdx == 0 ? -1 : m_Fds[0] };
+					const int fd{ static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, groupFd, 0)) };
+
+					if (fd < 0)
+					{
+						// without the leader there's no group at all
+						if (counterIdx == 0)
+						{
+							m_FailReason = std::string{ "perf_event_open failed: " } + std::strerror(errno);
+							return;
+						}
+						continue;
+					}
+
+					m_Fds[counterIdx] = fd;
+					ioctl(fd, PERF_EVENT_IOC_ID, &m_Ids[counterIdx]);
+				}
+
+				ioctl(m_Fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+				ioctl(m_Fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+			}
+
+			~ThreadCounters()
+			{
+				for (int& fd : m_Fds)
+				{
+					if (fd >= 0)
+						close(fd);
+					fd = -1;
+				}
+			}
+
+			ThreadCounters(const ThreadCounters&) = delete;
+			ThreadCounters(ThreadCounters&&) noexcept = delete;
+			ThreadCounters& operator=(const ThreadCounters&) = delete;
+			ThreadCounters& operator=(ThreadCounters&&) noexcept = delete;
+
+			bool IsOpen() const { return m_Fds[0] >= 0; }
+			bool IsSupported(int counterIdx) const { return m_Fds[counterIdx] >= 0; }
+			const std::string& GetFailReason() const { return m_FailReason; }
+
+			bool Read(PerfCounterValues& values) const
+			{
+				if (!IsOpen())
+					return false;
+
+				// PERF_FORMAT_GROUP | PERF_FORMAT_ID: the number of counters, then a value and id per counter
+				uint64_t buffer[1 + 2 * NrPerfCounters]{};
+				if (read(m_Fds[0], buffer, sizeof(buffer)) <= 0)
+					return false;
+
+				const uint64_t nrRead{ buffer[0] };
+				for (uint64_t readIdx{}; readIdx < nrRead && readIdx < NrPerfCounters; ++readIdx)
+				{
+					const uint64_t value{ buffer[1 + readIdx * 2] };
+					const uint64_t id{ buffer[2 + readIdx * 2] };
+
+					for (int counterIdx{}; counterIdx < NrPerfCounters; ++counterIdx)
+					{
+						if (m_Fds[counterIdx] >= 0 && m_Ids[counterIdx] == id)
+							values.values[counterIdx] = value;
+					}
+				}
+				return true;
+			}
+
+		private:
+			int m_Fds[NrPerfCounters]{ -1, -1, -1, -1, -1 };
+			uint64_t m_Ids[NrPerfCounters]{};
+			std::string m_FailReason{};
+		};
+
+		ThreadCounters& GetThreadCounters()
+		{
+			thread_local ThreadCounters counters{};
+			return counters;
+		}
+	}
+
+	bool PerfCounters::Read(PerfCounterValues& values)
+	{
+		return GetThreadCounters().Read(values);
+	}
+
+	bool PerfCounters::IsAvailable(std::string* pReason)
+	{
+		const ThreadCounters& counters{ GetThreadCounters() };
+		if (!counters.IsOpen() && pReason)
+			*pReason = counters.GetFailReason();
+		return counters.IsOpen();
+	}
+
+	bool PerfCounters::IsSupported(PerfCounter counter)
+	{
+		return GetThreadCounters().IsSupported(static_cast<int>(counter));
+	}
+#else
+	bool PerfCounters::Read(PerfCounterValues&)
+	{
+		return false;
+	}
+
+	bool PerfCounters::IsAvailable(std::string* pReason)
+	{
+		if (pReason)
+			*pReason = "hardware counters are only implemented on Linux";
+		return false;
+	}
+
+	bool PerfCounters::IsSupported(PerfCounter)
+	{
+		return false;
+	}
+#endif
+
+	const char* PerfCounters::GetName(PerfCounter counter)
+	{
+		switch (counter)
+		{
+		case PerfCounter::Cycles:
+			return "cycles";
+		case PerfCounter::Instructions:
+			return "instructions";
+		case PerfCounter::L1DataMisses:
+			return "l1d_misses";
+		case PerfCounter::LastLevelCacheMisses:
+			return "llc_misses";
+		case PerfCounter::BranchMisses:
+			return "branch_misses";
+		}
+		return "unknown";
+	}
+}
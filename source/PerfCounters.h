@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace dae
+{
+	enum class PerfCounter
+	{
+		Cycles,
+		Instructions,
+		L1DataMisses,
+		LastLevelCacheMisses,
+		BranchMisses
+	};
+
+	constexpr int NrPerfCounters{ 5 };
+
+	struct PerfCounterValues
+	{
+		uint64_t values[NrPerfCounters]{};
+
+		uint64_t Get(PerfCounter counter) const { return values[static_cast<int>(counter)]; }
+	};
+
+	// Hardware performance counters of the calling thread, user space only.
+	// Linux only (perf_event_open), everywhere else and when the kernel refuses (perf_event_paranoid, no PMU in a VM)
+	// every Read fails and callers stick to timings. Counters are opened per thread the first time it reads them.
+	class PerfCounters final
+	{
+	public:
+		PerfCounters() = delete;
+
+		// False when the counters can't be opened on this thread, values are left untouched then
+		static bool Read(PerfCounterValues& values);
+
+		// Opens the counters on the calling thread, on failure the reason ends up in pReason when given
+		static bool IsAvailable(std::string* pReason = nullptr);
+
+		// A single counter can be missing (LLC misses on some virtual machines) while the others work, it reads 0 then
+		static bool IsSupported(PerfCounter counter);
+
+		static const char* GetName(PerfCounter counter);
+	};
+}
@@ -0,0 +1,44 @@
+#include "PixelPacker.h"
+
+#include <emmintrin.h>
+
+namespace dae
+{
+	void PixelPacker::Pack(const ColorRGB* pColors, uint32_t* pPixels) const
+	{
+		static_assert(sizeof(ColorRGB) == 3 * sizeof(float), "ColorRGB has to be tightly packed");
+
+		// The 8 colors are 24 contiguous floats (r, g, b, r, g, b, ...), every channel gets the same
+		// saturate + scale, so there's no need to transpose to SoA first
+		const float* pChannels{ &pColors[0].r };
+
+		const __m128 zero{ _mm_setzero_ps() };
+		const __m128 one{ _mm_set1_ps(1.f) };
+		const __m128 scale{ _mm_set1_ps(255.f) };
+		const __m128 offset{ _mm_set1_ps(roundToNearest ? 0.5f : 0.f) };
+
+		__m128i channels[6];
+		for (int i{}; i < 6; ++i)
+		{
+			__m128 value{ _mm_loadu_ps(pChannels + i * 4) };
+			value = _mm_min_ps(_mm_max_ps(value, zero), one);
+			value = _mm_add_ps(_mm_mul_ps(value, scale), offset);
+			channels[i] = _mm_cvttps_epi32(value);
+		}
+
+		// 32 -> 16 -> 8 bit with saturation, 24 bytes of r, g, b triplets
+		alignas(16) uint8_t bytes[32];
+		const __m128i packed01{ _mm_packus_epi16(_mm_packs_epi32(channels[0], channels[1]), _mm_packs_epi32(channels[2], channels[3])) };
+		const __m128i packed23{ _mm_packus_epi16(_mm_packs_epi32(channels[4], channels[5]), _mm_setzero_si128()) };
+		_mm_store_si128(reinterpret_cast<__m128i*>(bytes), packed01);
+		_mm_store_si128(reinterpret_cast<__m128i*>(bytes + 16), packed23);
+
+		for (int i{}; i < BatchSize; ++i)
+		{
+			pPixels[i] = (static_cast<uint32_t>(bytes[i * 3]) << rShift) |
+				(static_cast<uint32_t>(bytes[i * 3 + 1]) << gShift) |
+				(static_cast<uint32_t>(bytes[i * 3 + 2]) << bShift) |
+				alphaMask;
+		}
+	}
+}
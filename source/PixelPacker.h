@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+
+#include "ColorRGB.h"
+
+namespace dae
+{
+	// Converts ColorRGB to packed 32-bit pixels of a surface format that was resolved once,
+	// replaces a SDL_MapRGB call per pixel
+	struct PixelPacker
+	{
+		uint32_t rShift{ 16 };
+		uint32_t gShift{ 8 };
+		uint32_t bShift{ 0 };
+		uint32_t alphaMask{ 0 };
+
+		// round to the nearest 8-bit value instead of truncating
+		bool roundToNearest{ false };
+
+		static constexpr int BatchSize{ 8 };
+
+		uint32_t Pack(const ColorRGB& color) const
+		{
+			const float offset{ roundToNearest ? 0.5f : 0.f };
+
+			const uint32_t r{ static_cast<uint32_t>(Saturate(color.r) * 255.f + offset) };
+			const uint32_t g{ static_cast<uint32_t>(Saturate(color.g) * 255.f + offset) };
+			const uint32_t b{ static_cast<uint32_t>(Saturate(color.b) * 255.f + offset) };
+
+			return (r << rShift) | (g << gShift) | (b << bShift) | alphaMask;
+		}
+
+		// Saturates and packs BatchSize colors at once (SSE2)
+		void Pack(const ColorRGB* pColors, uint32_t* pPixels) const;
+	};
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "Vector2.h"
+
+namespace dae
+{
+	// value(x, y) = dx * x + dy * y + offset, for anything that is linear in screen space
+	// (device z, 1/w and attribute/w), so a pixel only needs a plane evaluation instead of barycentrics
+	struct PlaneEquation
+	{
+		float dx{};
+		float dy{};
+		float offset{};
+
+		float Evaluate(float x, float y) const
+		{
+			return dx * x + dy * y + offset;
+		}
+
+		// Extremes over the rectangle [left, right] x [top, bottom], always at one of its corners
+		float GetMin(float left, float top, float right, float bottom) const
+		{
+			return Evaluate(dx < 0.f ? right : left, dy < 0.f ? bottom : top);
+		}
+
+		float GetMax(float left, float top, float right, float bottom) const
+		{
+			return Evaluate(dx < 0.f ? left : right, dy < 0.f ? top : bottom);
+		}
+	};
+
+	// Triangle setup shared by all planes of one triangle, the reciprocal of the area is only done once
+	class TrianglePlaneSetup final
+	{
+	public:
+		TrianglePlaneSetup(const Vector2& p0, const Vector2& p1, const Vector2& p2) :
+			m_Origin{ p0 },
+			m_Edge1{ p1 - p0 },
+			m_Edge2{ p2 - p0 },
+			m_InvArea{ 1.f / Vector2::Cross(p1 - p0, p2 - p0) }
+		{
+		}
+
+		PlaneEquation Create(float v0, float v1, float v2) const
+		{
+			const float deltaV1{ v1 - v0 };
+			const float deltaV2{ v2 - v0 };
+
+			PlaneEquation plane{};
+			plane.dx = (deltaV1 * m_Edge2.y - deltaV2 * m_Edge1.y) * m_InvArea;
+			plane.dy = (deltaV2 * m_Edge1.x - deltaV1 * m_Edge2.x) * m_InvArea;
+			plane.offset = v0 - plane.dx * m_Origin.x - plane.dy * m_Origin.y;
+			return plane;
+		}
+
+		// One plane per value, for any number of interpolated floats
+		void Create(const float* pValues0, const float* pValues1, const float* pValues2, int nrValues, PlaneEquation* pPlanes) const
+		{
+			for (int i{}; i < nrValues; ++i)
+			{
+				pPlanes[i] = Create(pValues0[i], pValues1[i], pValues2[i]);
+			}
+		}
+
+	private:
+		Vector2 m_Origin{};
+		Vector2 m_Edge1{};
+		Vector2 m_Edge2{};
+		float m_InvArea{};
+	};
+}
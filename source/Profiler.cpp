@@ -0,0 +1,169 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace dae
+{
+	namespace
+	{
+		// only touched when a thread records its first event and when exporting
+		std::mutex g_RegistryMutex{};
+	}
+
+	void Profiler::Record(const char* pName, uint64_t start, uint64_t end, const PerfCounterValues* pCounters)
+	{
+		thread_local ThreadBuffer* pBuffer{ RegisterThread() };
+
+		const uint64_t eventIdx{ pBuffer->nrWritten.load(std::memory_order_relaxed) };
+		pBuffer->events[eventIdx & (BufferCapacity - 1)] = ProfileEvent{ pName, start, end, pCounters != nullptr, pCounters ? *pCounters : PerfCounterValues{} };
+		pBuffer->nrWritten.store(eventIdx + 1, std::memory_order_release);
+	}
+
+	Profiler::ThreadBuffer* Profiler::RegisterThread()
+	{
+		const std::lock_guard lock{ g_RegistryMutex };
+
+		// buffers outlive their threads, the pool threads of the parallel algorithms can come and go
+		std::vector<std::unique_ptr<ThreadBuffer>>& buffers{ GetThreadBuffers() };
+		buffers.push_back(std::make_unique<ThreadBuffer>());
+		buffers.back()->threadIdx = static_cast<uint32_t>(buffers.size() - 1);
+		return buffers.back().get();
+	}
+
+	std::vector<std::unique_ptr<Profiler::ThreadBuffer>>& Profiler::GetThreadBuffers()
+	{
+		static std::vector<std::unique_ptr<ThreadBuffer>> buffers{};
+		return buffers;
+	}
+
+	void Profiler::Clear()
+	{
+		const std::lock_guard lock{ g_RegistryMutex };
+
+		// the owning thread keeps counting, everything before this point just isn't exported anymore
+		for (const std::unique_ptr<ThreadBuffer>& pBuffer : GetThreadBuffers())
+		{
+			pBuffer->nrCleared.store(pBuffer->nrWritten.load(std::memory_order_acquire), std::memory_order_relaxed);
+		}
+	}
+
+	std::vector<ProfileStageSummary> Profiler::GetStageSummaries()
+	{
+		const std::lock_guard lock{ g_RegistryMutex };
+
+		// names are compared by content, the same literal can live at different addresses in different translation units
+		std::vector<ProfileStageSummary> summaries{};
+		std::vector<uint32_t> nrCounted{};
+		const double millisecondsPerTick{ 1000.0 / static_cast<double>(SDL_GetPerformanceFrequency()) };
+
+		for (const std::unique_ptr<ThreadBuffer>& pBuffer : GetThreadBuffers())
+		{
+			const uint64_t nrWritten{ pBuffer->nrWritten.load(std::memory_order_acquire) };
+			const uint64_t oldestKept{ nrWritten > BufferCapacity ? nrWritten - BufferCapacity : 0 };
+
+			for (uint64_t eventIdx{ std::max(oldestKept, pBuffer->nrCleared.load(std::memory_order_relaxed)) }; eventIdx < nrWritten; ++eventIdx)
+			{
+				const ProfileEvent& event{ pBuffer->events[eventIdx & (BufferCapacity - 1)] };
+
+				auto summaryIt{ std::find_if(summaries.begin(), summaries.end(), [&event](const ProfileStageSummary& summary) { return summary.name == event.pName; }) };
+				if (summaryIt == summaries.end())
+				{
+					summaries.push_back(ProfileStageSummary{ event.pName });
+					nrCounted.push_back(0);
+					summaryIt = summaries.end() - 1;
+				}
+
+				++summaryIt->nrCalls;
+				summaryIt->totalMs += static_cast<double>(event.end - event.start) * millisecondsPerTick;
+
+				if (event.hasCounters)
+				{
+					++nrCounted[summaryIt - summaries.begin()];
+					for (int counterIdx{}; counterIdx < NrPerfCounters; ++counterIdx)
+						summaryIt->counters.values[counterIdx] += event.counters.values[counterIdx];
+				}
+			}
+		}
+
+		for (size_t summaryIdx{}; summaryIdx < summaries.size(); ++summaryIdx)
+			summaries[summaryIdx].hasCounters = nrCounted[summaryIdx] == summaries[summaryIdx].nrCalls;
+
+		std::sort(summaries.begin(), summaries.end(), [](const ProfileStageSummary& a, const ProfileStageSummary& b) { return a.totalMs > b.totalMs; });
+		return summaries;
+	}
+
+	bool Profiler::ExportChromeTrace(const std::string& path)
+	{
+		std::ofstream file{ path };
+		if (!file)
+			return false;
+
+		const std::lock_guard lock{ g_RegistryMutex };
+		const std::vector<std::unique_ptr<ThreadBuffer>>& buffers{ GetThreadBuffers() };
+
+		const auto getFirstEvent = [](const ThreadBuffer& buffer, uint64_t nrWritten)
+		{
+			const uint64_t oldestKept{ nrWritten > BufferCapacity ? nrWritten - BufferCapacity : 0 };
+			return std::max(oldestKept, buffer.nrCleared.load(std::memory_order_relaxed));
+		};
+
+		// timestamps start at the first recorded event
+		uint64_t firstTimestamp{ UINT64_MAX };
+		for (const std::unique_ptr<ThreadBuffer>& pBuffer : buffers)
+		{
+			const uint64_t nrWritten{ pBuffer->nrWritten.load(std::memory_order_acquire) };
+			for (uint64_t eventIdx{ getFirstEvent(*pBuffer, nrWritten) }; eventIdx < nrWritten; ++eventIdx)
+			{
+				firstTimestamp = std::min(firstTimestamp, pBuffer->events[eventIdx & (BufferCapacity - 1)].start);
+			}
+		}
+
+		const double microsecondsPerTick{ 1'000'000.0 / static_cast<double>(SDL_GetPerformanceFrequency()) };
+		bool isFirst{ true };
+		const auto separator = [&isFirst]()
+		{
+			const char* pSeparator{ isFirst ? "\n" : ",\n" };
+			isFirst = false;
+			return pSeparator;
+		};
+
+		file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+		for (const std::unique_ptr<ThreadBuffer>& pBuffer : buffers)
+		{
+			// thread 0 is whoever recorded first, the render thread in practice
+			const std::string threadName{ pBuffer->threadIdx == 0 ? "Render thread" : "Worker " + std::to_string(pBuffer->threadIdx) };
+			file << separator() << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << pBuffer->threadIdx
+				<< ", \"args\": {\"name\": \"" << threadName << "\"}}";
+
+			const uint64_t nrWritten{ pBuffer->nrWritten.load(std::memory_order_acquire) };
+			for (uint64_t eventIdx{ getFirstEvent(*pBuffer, nrWritten) }; eventIdx < nrWritten; ++eventIdx)
+			{
+				const ProfileEvent& event{ pBuffer->events[eventIdx & (BufferCapacity - 1)] };
+
+				// complete events, nested scopes on one thread show up as a stack
+				file << separator() << "{\"name\": \"" << event.pName << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << pBuffer->threadIdx
+					<< ", \"ts\": " << static_cast<double>(event.start - firstTimestamp) * microsecondsPerTick
+					<< ", \"dur\": " << static_cast<double>(event.end - event.start) * microsecondsPerTick;
+
+				// counters show up in the event details
+				if (event.hasCounters)
+				{
+					file << ", \"args\": {";
+					for (int counterIdx{}; counterIdx < NrPerfCounters; ++counterIdx)
+					{
+						file << (counterIdx ? ", \"" : "\"") << PerfCounters::GetName(static_cast<PerfCounter>(counterIdx)) << "\": " << event.counters.values[counterIdx];
+					}
+					file << "}";
+				}
+				file << "}";
+			}
+		}
+		file << "\n]}" << std::endl;
+
+		return static_cast<bool>(file);
+	}
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <SDL_timer.h>
+
+#include "PerfCounters.h"
+
+// The Profile configuration (Release with ENABLE_PROFILING defined) records the profiling markers,
+// without it PROFILE_SCOPE expands to nothing and costs nothing
+
+#ifdef ENABLE_PROFILING
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+// Times the rest of the enclosing scope, name has to be a string literal (only the pointer gets stored)
+#define PROFILE_SCOPE(name) const dae::ProfileScope PROFILE_CONCAT(profileScope, __LINE__){ name }
+#else
+#define PROFILE_SCOPE(name)
+#endif
+
+namespace dae
+{
+	struct ProfileEvent
+	{
+		const char* pName{ nullptr };
+		// performance counter ticks
+		uint64_t start{};
+		uint64_t end{};
+
+		// hardware counter deltas over the scope, when they were enabled and available on the thread
+		bool hasCounters{};
+		PerfCounterValues counters{};
+	};
+
+	// Everything recorded for one marker name
+	struct ProfileStageSummary
+	{
+		std::string name{};
+		uint32_t nrCalls{};
+		double totalMs{};
+		// only when every call got counted
+		bool hasCounters{};
+		PerfCounterValues counters{};
+	};
+
+	// Collects the markers of every thread and writes them out as a Chrome trace (chrome://tracing or ui.perfetto.dev).
+	// Every thread records into its own ring buffer, so recording never locks, only the first event of a thread
+	// registers its buffer. When a buffer wraps around the oldest events get overwritten.
+	class Profiler final
+	{
+	public:
+		Profiler() = delete;
+
+		static bool IsEnabled()
+		{
+#ifdef ENABLE_PROFILING
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		static uint64_t GetTimestamp() { return SDL_GetPerformanceCounter(); }
+
+		static void Record(const char* pName, uint64_t start, uint64_t end, const PerfCounterValues* pCounters = nullptr);
+
+		// Markers read the hardware counters of their thread as well (see PerfCounters), off by default since
+		// every read is a system call. Threads where the counters can't be opened keep recording timings only
+		static void SetCountersEnabled(bool isEnabled) { m_CountersEnabled.store(isEnabled, std::memory_order_relaxed); }
+		static bool AreCountersEnabled() { return m_CountersEnabled.load(std::memory_order_relaxed); }
+
+		// Totals per marker name over the events still in the buffers, slowest stage first.
+		// Stages nest (the frame contains everything), so the times are inclusive
+		static std::vector<ProfileStageSummary> GetStageSummaries();
+
+		// Not synchronized with the recording threads, call it when no frame is being rendered.
+		// Returns false when the file can't be written
+		static bool ExportChromeTrace(const std::string& path);
+
+		// Drops everything recorded so far
+		static void Clear();
+
+	private:
+		static constexpr uint32_t BufferCapacity{ 1 << 14 };
+
+		static inline std::atomic<bool> m_CountersEnabled{ false };
+
+		struct ThreadBuffer
+		{
+			uint32_t threadIdx{};
+			// written by the owning thread only, the events before it are complete
+			std::atomic<uint64_t> nrWritten{};
+			std::atomic<uint64_t> nrCleared{};
+			ProfileEvent events[BufferCapacity]{};
+		};
+
+		static ThreadBuffer* RegisterThread();
+		static std::vector<std::unique_ptr<ThreadBuffer>>& GetThreadBuffers();
+	};
+
+	class ProfileScope final
+	{
+	public:
+		explicit ProfileScope(const char* pName) :
+			m_pName{ pName }
+		{
+			// counters are read outside of the timed part, the system call shouldn't show up in the timings
+			if (Profiler::AreCountersEnabled())
+				m_HasCounters = PerfCounters::Read(m_StartCounters);
+			m_Start = Profiler::GetTimestamp();
+		}
+
+		~ProfileScope()
+		{
+			const uint64_t end{ Profiler::GetTimestamp() };
+
+			PerfCounterValues counters{};
+			if (m_HasCounters && PerfCounters::Read(counters))
+			{
+				for (int counterIdx{}; counterIdx < NrPerfCounters; ++counterIdx)
+					counters.values[counterIdx] -= m_StartCounters.values[counterIdx];
+
+				Profiler::Record(m_pName, m_Start, end, &counters);
+				return;
+			}
+
+			Profiler::Record(m_pName, m_Start, end);
+		}
+
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope(ProfileScope&&) noexcept = delete;
+		ProfileScope& operator=(const ProfileScope&) = delete;
+		ProfileScope& operator=(ProfileScope&&) noexcept = delete;
+
+	private:
+		const char* m_pName{ nullptr };
+		uint64_t m_Start{};
+
+		bool m_HasCounters{};
+		PerfCounterValues m_StartCounters{};
+	};
+}
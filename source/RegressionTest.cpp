@@ -0,0 +1,292 @@
+#include "RegressionTest.h"
+
+#include "SDL.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include "Renderer.h"
+#include "Scene.h"
+
+namespace dae
+{
+	namespace
+	{
+		// Pipeline state a case renders with, the defaults are the ones the renderer starts with
+		struct RegressionPipeline
+		{
+			Renderer::RenderMode renderMode{ Renderer::RenderMode::Forward };
+			DepthFormat depthFormat{ DepthFormat::D32Float };
+			bool useQuantizedVertices{ false };
+			bool useOcclusionCulling{ true };
+			bool useHierarchicalZ{ true };
+		};
+
+		struct RegressionCase
+		{
+			const char* pName;
+			SceneType scene;
+			Vector3 origin;
+			// degrees, like Camera::SetPose
+			float pitch;
+			float yaw;
+			RegressionPipeline pipeline{};
+		};
+
+		// Changing a pose or adding a case needs the references to be updated.
+		// The pipeline cases use the vehicle, the scene with the most triangles and overdraw
+		const RegressionCase g_Cases[]{
+			{ "quad", SceneType::Quad, { 0.f, 5.f, -30.f }, 0.f, 0.f },
+			{ "quadfield", SceneType::QuadField, { 0.f, 5.f, -30.f }, 0.f, 0.f },
+			{ "quadfield_angled", SceneType::QuadField, { -20.f, 15.f, -30.f }, -15.f, 30.f },
+			{ "vehicle", SceneType::Vehicle, { 0.f, 5.f, -30.f }, 0.f, 0.f },
+			{ "tuktuk", SceneType::TukTuk, { 0.f, 5.f, -30.f }, 0.f, 0.f },
+			{ "tuktuk_side", SceneType::TukTuk, { 30.f, 5.f, 0.f }, 0.f, -90.f },
+			{ "vehicle_deferred", SceneType::Vehicle, { 0.f, 5.f, -30.f }, 0.f, 0.f, { .renderMode = Renderer::RenderMode::Deferred } },
+			{ "vehicle_visibility_buffer", SceneType::Vehicle, { 0.f, 5.f, -30.f }, 0.f, 0.f, { .renderMode = Renderer::RenderMode::VisibilityBuffer } },
+			{ "vehicle_depth_prepass", SceneType::Vehicle, { 0.f, 5.f, -30.f }, 0.f, 0.f, { .renderMode = Renderer::RenderMode::DepthPrePass } },
+			{ "vehicle_d32_reversed", SceneType::Vehicle, { 0.f, 5.f, -30.f }, 0.f, 0.f, { .depthFormat = DepthFormat::D32FloatReversed } },
+			{ "vehicle_d24", SceneType::Vehicle, { 0.f, 5.f, -30.f }, 0.f, 0.f, { .depthFormat = DepthFormat::D24Unorm } },
+			{ "vehicle_d16", SceneType::Vehicle, { 0.f, 5.f, -30.f }, 0.f, 0.f, { .depthFormat = DepthFormat::D16Unorm } },
+			{ "vehicle_quantized", SceneType::Vehicle, { 0.f, 5.f, -30.f }, 0.f, 0.f, { .useQuantizedVertices = true } },
+			{ "tuktuk_side_no_occlusion", SceneType::TukTuk, { 30.f, 5.f, 0.f }, 0.f, -90.f, { .useOcclusionCulling = false, .useHierarchicalZ = false } }
+		};
+
+		// returns false when the renderer refused the pipeline
+		bool ApplyPipeline(Renderer& renderer, const RegressionPipeline& pipeline)
+		{
+			renderer.SetDepthFormat(pipeline.depthFormat);
+			renderer.SetQuantizedVertices(pipeline.useQuantizedVertices);
+			renderer.SetOcclusionCulling(pipeline.useOcclusionCulling);
+			renderer.SetHierarchicalZ(pipeline.useHierarchicalZ);
+			return renderer.SetRenderMode(pipeline.renderMode);
+		}
+
+		struct ImageDifference
+		{
+			bool isSameSize{};
+			// largest difference of one channel
+			int maxDifference{};
+			// infinite for identical images
+			double psnr{};
+			uint32_t nrDifferentPixels{};
+		};
+
+		ImageDifference CompareWithReference(const Renderer& renderer, const std::string& referencePath, bool& isLoaded)
+		{
+			ImageDifference difference{};
+
+			SDL_Surface* pLoaded{ SDL_LoadBMP(referencePath.c_str()) };
+			isLoaded = pLoaded != nullptr;
+			if (!pLoaded)
+				return difference;
+
+			// whatever layout the file has, compare in one known layout
+			SDL_Surface* pReference{ SDL_ConvertSurfaceFormat(pLoaded, SDL_PIXELFORMAT_ARGB8888, 0) };
+			SDL_FreeSurface(pLoaded);
+			if (!pReference)
+			{
+				isLoaded = false;
+				return difference;
+			}
+
+			difference.isSameSize = pReference->w == renderer.GetWidth() && pReference->h == renderer.GetHeight();
+			if (!difference.isSameSize)
+			{
+				SDL_FreeSurface(pReference);
+				return difference;
+			}
+
+			const PixelPacker& packer{ renderer.GetPixelPacker() };
+			const uint32_t* pPixels{ renderer.GetBackBufferPixels() };
+
+			double squaredErrorSum{};
+			for (int py{}; py < pReference->h; ++py)
+			{
+				const uint32_t* pReferenceRow{ reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(pReference->pixels) + py * pReference->pitch) };
+
+				for (int px{}; px < pReference->w; ++px)
+				{
+					const uint32_t pixel{ pPixels[px + py * renderer.GetWidth()] };
+					const uint32_t referencePixel{ pReferenceRow[px] };
+
+					const int channels[3]{
+						static_cast<int>((pixel >> packer.rShift) & 0xFF) - static_cast<int>((referencePixel >> 16) & 0xFF),
+						static_cast<int>((pixel >> packer.gShift) & 0xFF) - static_cast<int>((referencePixel >> 8) & 0xFF),
+						static_cast<int>((pixel >> packer.bShift) & 0xFF) - static_cast<int>(referencePixel & 0xFF)
+					};
+
+					bool isDifferent{ false };
+					for (const int channel : channels)
+					{
+						difference.maxDifference = std::max(difference.maxDifference, std::abs(channel));
+						squaredErrorSum += static_cast<double>(channel * channel);
+						isDifferent |= channel != 0;
+					}
+					difference.nrDifferentPixels += isDifferent ? 1 : 0;
+				}
+			}
+
+			const double meanSquaredError{ squaredErrorSum / (3.0 * pReference->w * pReference->h) };
+			difference.psnr = meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : INFINITY;
+
+			SDL_FreeSurface(pReference);
+			return difference;
+		}
+
+		// Fastest of the timed frames, rendering the same pose every frame. Other processes and frequency scaling
+		// only ever add time, so the minimum is far more repeatable than the mean or median on a shared machine
+		float MeasureFrameTime(Renderer& renderer, const RegressionTestOptions& options)
+		{
+			for (int frameIdx{}; frameIdx < options.nrWarmupFrames; ++frameIdx)
+				renderer.Render();
+
+			std::vector<float> frameTimes{};
+			for (int frameIdx{}; frameIdx < options.nrTimedFrames; ++frameIdx)
+			{
+				const uint64_t startTime{ SDL_GetPerformanceCounter() };
+				renderer.Render();
+				frameTimes.push_back(static_cast<float>(SDL_GetPerformanceCounter() - startTime) * 1000.f / static_cast<float>(SDL_GetPerformanceFrequency()));
+			}
+
+			return *std::min_element(frameTimes.begin(), frameTimes.end());
+		}
+
+		// one "case frame_ms" per line
+		std::map<std::string, float> LoadBaseline(const std::string& path)
+		{
+			std::map<std::string, float> baseline{};
+
+			std::ifstream file{ path };
+			std::string line{};
+			while (std::getline(file, line))
+			{
+				if (line.empty() || line[0] == '#')
+					continue;
+
+				std::istringstream lineStream{ line };
+				std::string name{};
+				float frameMs{};
+				if (lineStream >> name >> frameMs)
+					baseline[name] = frameMs;
+			}
+
+			return baseline;
+		}
+	}
+
+	int RunRegressionTest(const RegressionTestOptions& options)
+	{
+		const std::filesystem::path directory{ options.directory };
+		const std::string baselinePath{ (directory / "baseline.txt").string() };
+
+		if (options.updateReferences)
+		{
+			std::error_code error{};
+			std::filesystem::create_directories(directory, error);
+		}
+
+		const std::map<std::string, float> baseline{ options.updateReferences ? std::map<std::string, float>{} : LoadBaseline(baselinePath) };
+		std::ostringstream newBaseline{};
+		newBaseline << "# case frame_ms (" << options.width << "x" << options.height << ")\n";
+
+		int nrFailed{};
+		for (const RegressionCase& testCase : g_Cases)
+		{
+			Renderer* pRenderer{ new Renderer(options.width, options.height, testCase.scene) };
+			pRenderer->GetCamera().SetPose(testCase.origin, testCase.pitch, testCase.yaw);
+
+			if (!ApplyPipeline(*pRenderer, testCase.pipeline))
+			{
+				std::cout << "FAIL " << testCase.pName << ": the renderer doesn't support this pipeline for the scene" << std::endl;
+				++nrFailed;
+				delete pRenderer;
+				continue;
+			}
+
+			// the timed frames render the same image, the last one is what gets compared
+			const float frameMs{ MeasureFrameTime(*pRenderer, options) };
+			const std::string referencePath{ (directory / (std::string{ testCase.pName } + ".bmp")).string() };
+
+			if (options.updateReferences)
+			{
+				if (pRenderer->SaveBufferToImage(referencePath.c_str()))
+				{
+					std::cout << "FAIL " << testCase.pName << ": couldn't write " << referencePath << std::endl;
+					++nrFailed;
+				}
+				else
+					std::cout << "UPDATED " << testCase.pName << ": " << frameMs << " ms" << std::endl;
+
+				newBaseline << testCase.pName << " " << frameMs << "\n";
+				delete pRenderer;
+				continue;
+			}
+
+			bool isLoaded{};
+			const ImageDifference difference{ CompareWithReference(*pRenderer, referencePath, isLoaded) };
+			delete pRenderer;
+
+			std::ostringstream report{};
+			bool hasPassed{ true };
+
+			if (!isLoaded)
+			{
+				report << "no reference image " << referencePath << " (run with --update-golden)";
+				hasPassed = false;
+			}
+			else if (!difference.isSameSize)
+			{
+				report << "reference image has a different resolution";
+				hasPassed = false;
+			}
+			else
+			{
+				report << "PSNR " << difference.psnr << " dB / max diff " << difference.maxDifference << " / " << difference.nrDifferentPixels << " pixels differ";
+				if (difference.psnr < options.minPsnr || difference.maxDifference > options.maxPixelDiff)
+				{
+					report << " [image regressed]";
+					hasPassed = false;
+				}
+			}
+
+			report << " / " << frameMs << " ms";
+			const auto baselineIt{ baseline.find(testCase.pName) };
+			if (baselineIt == baseline.end())
+				report << " (no baseline)";
+			else
+			{
+				const float slowdown{ frameMs / baselineIt->second - 1.f };
+				report << " (baseline " << baselineIt->second << " ms, " << (slowdown >= 0.f ? "+" : "") << slowdown * 100.f << "%)";
+				if (options.maxSlowdown >= 0.f && slowdown > options.maxSlowdown)
+				{
+					report << " [performance regressed]";
+					hasPassed = false;
+				}
+			}
+
+			std::cout << (hasPassed ? "PASS " : "FAIL ") << testCase.pName << ": " << report.str() << std::endl;
+			nrFailed += hasPassed ? 0 : 1;
+		}
+
+		if (options.updateReferences)
+		{
+			std::ofstream file{ baselinePath };
+			file << newBaseline.str();
+			if (!file)
+			{
+				std::cout << "Couldn't write " << baselinePath << std::endl;
+				++nrFailed;
+			}
+		}
+
+		std::cout << (std::size(g_Cases) - nrFailed) << "/" << std::size(g_Cases) << (options.updateReferences ? " references written" : " cases passed") << std::endl;
+		return nrFailed;
+	}
+}
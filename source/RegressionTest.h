@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+
+namespace dae
+{
+	struct RegressionTestOptions
+	{
+		// reference images (<case>.bmp) and the frame time baseline (baseline.txt)
+		std::string directory{ "Resources/Golden" };
+		// render every case and store the results as the new references and baseline instead of comparing
+		bool updateReferences{ false };
+
+		int width{ 640 };
+		int height{ 480 };
+
+		// image gate: fails below this PSNR (dB, over RGB) or when one channel of a pixel is off by more than maxPixelDiff.
+		// The references come from the same renderer, so only rounding noise is tolerated, anything that moves an edge
+		// or changes a texel needs the references to be updated
+		float minPsnr{ 40.f };
+		int maxPixelDiff{ 4 };
+
+		// performance gate: fails when the fastest frame is more than this fraction slower than the baseline,
+		// a negative value skips it. Baselines only mean something on the machine that recorded them
+		float maxSlowdown{ 0.15f };
+		int nrWarmupFrames{ 5 };
+		int nrTimedFrames{ 30 };
+	};
+
+	// Renders a fixed set of scenes and camera poses headless and compares them against the references.
+	// Prints a line per case, returns the number of failed cases (or the number of references that couldn't be written)
+	int RunRegressionTest(const RegressionTestOptions& options);
+}
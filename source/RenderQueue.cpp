@@ -0,0 +1,71 @@
+#include "RenderQueue.h"
+#include "MathHelpers.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace dae
+{
+	uint32_t MakeOpaqueSortKey(float viewDepth, float nearPlane, float farPlane, uint8_t materialId)
+	{
+		constexpr uint32_t maxDepthKey{ 0xFFFF };
+
+		// linear between the planes, anything in front of the near plane sorts first
+		const float depth01{ Saturate((viewDepth - nearPlane) / (farPlane - nearPlane)) };
+		const uint32_t depthKey{ static_cast<uint32_t>(depth01 * static_cast<float>(maxDepthKey) + 0.5f) };
+
+		return (depthKey << 8) | materialId;
+	}
+
+	void RadixSort(std::span<DrawItem> items, std::span<DrawItem> scratch)
+	{
+		assert(scratch.size() >= items.size());
+
+		if (items.size() < 2)
+			return;
+
+		constexpr int nrPasses{ 4 };
+		constexpr int nrBuckets{ 256 };
+
+		// all histograms in one go over the keys
+		uint32_t histograms[nrPasses][nrBuckets]{};
+		for (const DrawItem& item : items)
+		{
+			for (int pass{}; pass < nrPasses; ++pass)
+			{
+				++histograms[pass][(item.sortKey >> (pass * 8)) & 0xFF];
+			}
+		}
+
+		DrawItem* pSource{ items.data() };
+		DrawItem* pDestination{ scratch.data() };
+
+		for (int pass{}; pass < nrPasses; ++pass)
+		{
+			const uint32_t* pHistogram{ histograms[pass] };
+
+			// every key has the same byte here, the pass wouldn't move anything
+			if (pHistogram[(pSource[0].sortKey >> (pass * 8)) & 0xFF] == items.size())
+				continue;
+
+			uint32_t offsets[nrBuckets];
+			uint32_t offset{};
+			for (int bucket{}; bucket < nrBuckets; ++bucket)
+			{
+				offsets[bucket] = offset;
+				offset += pHistogram[bucket];
+			}
+
+			for (size_t itemIdx{}; itemIdx < items.size(); ++itemIdx)
+			{
+				const DrawItem& item{ pSource[itemIdx] };
+				pDestination[offsets[(item.sortKey >> (pass * 8)) & 0xFF]++] = item;
+			}
+
+			std::swap(pSource, pDestination);
+		}
+
+		if (pSource != items.data())
+			std::copy_n(pSource, items.size(), items.data());
+	}
+}
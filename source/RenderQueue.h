@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+#include <span>
+
+namespace dae
+{
+	// One draw in the render queue, meshIdx points into the scene's meshes
+	struct DrawItem
+	{
+		uint32_t sortKey{};
+		uint32_t meshIdx{};
+	};
+
+	// Key for opaque draws: view depth quantized to 16 bits on top so the queue goes front to back,
+	// the material below it so draws that land in the same depth step stay grouped per texture
+	uint32_t MakeOpaqueSortKey(float viewDepth, float nearPlane, float farPlane, uint8_t materialId);
+
+	// Stable LSD radix sort on the sort key, one byte per pass, scratch needs room for as many items.
+	// Passes where every key has the same byte get skipped, the sorted result always ends up in items
+	void RadixSort(std::span<DrawItem> items, std::span<DrawItem> scratch);
+}
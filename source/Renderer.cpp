@@ -2,17 +2,27 @@
 #include "SDL.h"
 #include "SDL_surface.h"
 #include <iostream>
+#include <execution>
+#include <numeric>
 
 //Project includes
 #include "Renderer.h"
+#include "DepthBuffer.h"
+#include "GBuffer.h"
 #include "Math.h"
 #include "Matrix.h"
+#include "MeshClusters.h"
+#include "OcclusionBuffer.h"
+#include "PlaneEquation.h"
+#include "Profiler.h"
+#include "Scene.h"
 #include "Texture.h"
 #include "Utils.h"
+#include "VertexQuantization.h"
 
 using namespace dae;
 
-Renderer::Renderer(SDL_Window* pWindow) :
+Renderer::Renderer(SDL_Window* pWindow, SceneType scene) :
 	m_pWindow(pWindow),
 	m_pTexture{}
 {
@@ -24,25 +34,82 @@ Renderer::Renderer(SDL_Window* pWindow) :
 	m_pBackBuffer = SDL_CreateRGBSurface(0, m_Width, m_Height, 32, 0, 0, 0, 0);
 	m_pBackBufferPixels = (uint32_t*)m_pBackBuffer->pixels;
 
-	m_pDepthBufferPixels = new float[m_Width * m_Height];
+	// Resolve the surface format once, pixels get packed directly afterwards
+	m_PixelPacker.rShift = m_pBackBuffer->format->Rshift;
+	m_PixelPacker.gShift = m_pBackBuffer->format->Gshift;
+	m_PixelPacker.bShift = m_pBackBuffer->format->Bshift;
+	m_PixelPacker.alphaMask = m_pBackBuffer->format->Amask;
+
+	Initialize(scene);
+}
+
+Renderer::Renderer(int width, int height, SceneType scene) :
+	m_Width{ width },
+	m_Height{ height },
+	m_pTexture{}
+{
+	// same XRGB layout SDL_CreateRGBSurface picks by default, which is what the packer defaults to
+	m_pBackBufferPixels = new uint32_t[static_cast<size_t>(m_Width) * m_Height];
+
+	Initialize(scene);
+}
+
+void Renderer::Initialize(SceneType scene)
+{
 	m_AspectRatio = static_cast<float>(m_Width) / m_Height;
 
-	const int nrPixels{ m_Width * m_Height };
-	m_pDepthBufferPixels = new float[nrPixels];
-	std::fill_n(m_pDepthBufferPixels, nrPixels, FLT_MAX);
+	m_pDepthBuffer = new DepthBuffer(m_Width, m_Height);
+
+	// Color tiles use the same grid as the depth buffer
+	m_TilesX = (m_Width + DepthBuffer::TileSize - 1) / DepthBuffer::TileSize;
+	m_TilesY = (m_Height + DepthBuffer::TileSize - 1) / DepthBuffer::TileSize;
+	m_pColorTileCleared = new uint8_t[m_TilesX * m_TilesY];
+
+	m_TileRows.resize(m_TilesY);
+	std::iota(m_TileRows.begin(), m_TileRows.end(), 0);
+
+	m_pGBuffer = new GBuffer(m_Width, m_Height);
+	m_pTriangleIds = new uint32_t[m_Width * m_Height];
+	m_pFrameArena = new FrameArena(FrameArenaCapacity);
+	m_pOcclusionBuffer = new OcclusionBuffer(m_Width / OcclusionDownscale, m_Height / OcclusionDownscale);
+
+	// Define Mesh, once so load time work like quantizing isn't redone every frame
+	m_Meshes = CreateScene(scene);
+
+	for (Mesh& mesh : m_Meshes)
+	{
+		BuildClusters(mesh);
+	}
+
+	m_VisibilityBufferSupported = FitsTriangleIds(m_Meshes);
 
 	//Initialize Camera
 	m_Camera.Initialize(float(m_Width) / m_Height, 60.f, { 0.f, 5.f, -30.f });
 
-	m_pTexture = m_pTexture->LoadFromFile("Resources/uv_grid_2.png");
+	m_pTexture = m_pTexture->LoadFromFile(GetSceneTexturePath(scene));
 }
 
 Renderer::~Renderer()
 {
-	delete[] m_pDepthBufferPixels;
-	m_pDepthBufferPixels = nullptr;
+	delete m_pDepthBuffer;
+	m_pDepthBuffer = nullptr;
+	delete[] m_pColorTileCleared;
+	m_pColorTileCleared = nullptr;
+	delete m_pGBuffer;
+	m_pGBuffer = nullptr;
+	delete[] m_pTriangleIds;
+	m_pTriangleIds = nullptr;
+	delete m_pFrameArena;
+	m_pFrameArena = nullptr;
+	delete m_pOcclusionBuffer;
+	m_pOcclusionBuffer = nullptr;
 	delete m_pTexture;
 	m_pTexture = nullptr;
+
+	// the window's back buffer pixels belong to its surface
+	if (!m_pBackBuffer)
+		delete[] m_pBackBufferPixels;
+	m_pBackBufferPixels = nullptr;
 }
 
 void Renderer::Update(Timer* pTimer)
@@ -52,12 +119,21 @@ void Renderer::Update(Timer* pTimer)
 
 void Renderer::Render()
 {
+	PROFILE_SCOPE("Frame");
+
 	//@START
 	//Lock BackBuffer
-	SDL_FillRect(m_pBackBuffer, nullptr, SDL_MapRGB(m_pBackBuffer->format, 100, 100, 100));
-	const int nrPixels{ m_Width * m_Height };
-	std::fill_n(m_pDepthBufferPixels, nrPixels, FLT_MAX);
-	SDL_LockSurface(m_pBackBuffer);
+	{
+		PROFILE_SCOPE("Clear");
+
+		// Fast clear, only resets the per-tile flags, the actual clear color is written on first touch or at resolve
+		m_ClearColor = (100u << m_PixelPacker.rShift) | (100u << m_PixelPacker.gShift) | (100u << m_PixelPacker.bShift) | m_PixelPacker.alphaMask;
+		std::fill_n(m_pColorTileCleared, m_TilesX * m_TilesY, uint8_t{ 1 });
+		m_pDepthBuffer->Clear();
+		m_FrameStats = FrameStats{};
+		if (m_pBackBuffer)
+			SDL_LockSurface(m_pBackBuffer);
+	}
 
 	//RENDER LOGIC
 	//for (int px{}; px < m_Width; ++px)
@@ -84,10 +160,262 @@ void Renderer::Render()
 	RenderW7();
 
 	//@END
+	ResolveBackBuffer();
+
 	//Update SDL Surface
-	SDL_UnlockSurface(m_pBackBuffer);
-	SDL_BlitSurface(m_pBackBuffer, 0, m_pFrontBuffer, 0);
-	SDL_UpdateWindowSurface(m_pWindow);
+	if (m_pWindow)
+	{
+		PROFILE_SCOPE("Present");
+
+		SDL_UnlockSurface(m_pBackBuffer);
+		SDL_BlitSurface(m_pBackBuffer, 0, m_pFrontBuffer, 0);
+		SDL_UpdateWindowSurface(m_pWindow);
+	}
+
+	m_FrameStats.frameArenaBytes = m_pFrameArena->GetUsedBytes();
+	m_FrameStats.frameArenaHighWaterMark = m_pFrameArena->GetHighWaterMark();
+	m_pFrameArena->Reset();
+}
+
+void Renderer::WritePixel(int px, int py, uint32_t color)
+{
+	TouchColorTile(px, py);
+	m_pBackBufferPixels[px + (py * m_Width)] = color;
+}
+
+void Renderer::TouchColorTile(int px, int py)
+{
+	const int tileIdx{ (px >> DepthBuffer::TileShift) + (py >> DepthBuffer::TileShift) * m_TilesX };
+	if (m_pColorTileCleared[tileIdx])
+	{
+		// first write to this tile this frame, give the rest of the tile its clear color
+		FillTile(m_pBackBufferPixels, tileIdx, m_ClearColor);
+		m_pColorTileCleared[tileIdx] = 0;
+
+		if (m_RenderMode == RenderMode::Deferred)
+			m_pGBuffer->ClearTile(tileIdx);
+		else if (m_RenderMode == RenderMode::VisibilityBuffer)
+			FillTile(m_pTriangleIds, tileIdx, 0);
+	}
+}
+
+void Renderer::FlushPixelBatch(const ColorRGB* pColors, const int* pPixelIndices, int count)
+{
+	if (count == PixelPacker::BatchSize)
+	{
+		uint32_t packedPixels[PixelPacker::BatchSize];
+		m_PixelPacker.Pack(pColors, packedPixels);
+
+		for (int i{}; i < PixelPacker::BatchSize; ++i)
+		{
+			m_pBackBufferPixels[pPixelIndices[i]] = packedPixels[i];
+		}
+		return;
+	}
+
+	// partial batch at the end of a triangle
+	for (int i{}; i < count; ++i)
+	{
+		m_pBackBufferPixels[pPixelIndices[i]] = m_PixelPacker.Pack(pColors[i]);
+	}
+}
+
+void Renderer::FillTile(uint32_t* pBuffer, int tileIdx, uint32_t value)
+{
+	const int tileX{ (tileIdx % m_TilesX) * DepthBuffer::TileSize };
+	const int tileY{ (tileIdx / m_TilesX) * DepthBuffer::TileSize };
+	const int tileWidth{ std::min(DepthBuffer::TileSize, m_Width - tileX) };
+	const int tileHeight{ std::min(DepthBuffer::TileSize, m_Height - tileY) };
+
+	for (int py{ tileY }; py < tileY + tileHeight; ++py)
+	{
+		std::fill_n(pBuffer + tileX + (py * m_Width), tileWidth, value);
+	}
+}
+
+void Renderer::ResolveBackBuffer()
+{
+	PROFILE_SCOPE("Resolve");
+
+	// Untouched tiles only get their clear color now
+	const int nrTiles{ m_TilesX * m_TilesY };
+	for (int tileIdx{}; tileIdx < nrTiles; ++tileIdx)
+	{
+		if (m_pColorTileCleared[tileIdx])
+			FillTile(m_pBackBufferPixels, tileIdx, m_ClearColor);
+	}
+}
+
+void Renderer::ShadeDeferred(const std::vector<Mesh>& meshes)
+{
+	PROFILE_SCOPE("Shading");
+
+	// Every visible pixel gets shaded exactly once, tile rows are spread over the available cores
+	m_FrameStats.shadedPixels = std::transform_reduce(std::execution::par, m_TileRows.begin(), m_TileRows.end(), uint32_t{},
+		std::plus<>{}, [this, &meshes](int tileY) { return ShadeDeferredTileRow(tileY, meshes); });
+}
+
+uint32_t Renderer::ShadeDeferredTileRow(int tileY, const std::vector<Mesh>& meshes)
+{
+	// runs on the worker threads
+	PROFILE_SCOPE("Shade tile row");
+
+	uint32_t shadedPixels{};
+
+	ColorRGB colorBatch[PixelPacker::BatchSize]{};
+	int pixelBatch[PixelPacker::BatchSize]{};
+	int batchCount{};
+
+	const int top{ tileY * DepthBuffer::TileSize };
+	const int bottom{ std::min(top + DepthBuffer::TileSize, m_Height) };
+
+	for (int tileX{}; tileX < m_TilesX; ++tileX)
+	{
+		// nothing got rasterized in this tile, resolve gives it the clear color
+		if (m_pColorTileCleared[tileX + tileY * m_TilesX])
+			continue;
+
+		const int left{ tileX * DepthBuffer::TileSize };
+		const int right{ std::min(left + DepthBuffer::TileSize, m_Width) };
+
+		for (int py{ top }; py < bottom; ++py)
+		{
+			for (int px{ left }; px < right; ++px)
+			{
+				const int pixelIdx{ px + (py * m_Width) };
+
+				if (m_RenderMode == RenderMode::VisibilityBuffer)
+				{
+					const uint32_t triangleId{ m_pTriangleIds[pixelIdx] };
+					if (triangleId == 0)
+						continue;
+
+					colorBatch[batchCount] = ShadeVisibilityPixel(px, py, meshes, triangleId);
+				}
+				else
+				{
+					if (!m_pGBuffer->IsCovered(pixelIdx))
+						continue;
+
+					colorBatch[batchCount] = ShadeGBufferPixel(px, py);
+				}
+
+				pixelBatch[batchCount] = pixelIdx;
+				++shadedPixels;
+
+				if (++batchCount == PixelPacker::BatchSize)
+				{
+					FlushPixelBatch(colorBatch, pixelBatch, batchCount);
+					batchCount = 0;
+				}
+			}
+		}
+	}
+
+	FlushPixelBatch(colorBatch, pixelBatch, batchCount);
+	return shadedPixels;
+}
+
+ColorRGB Renderer::ShadeGBufferPixel(int px, int py) const
+{
+	switch (m_VisualizationMethod)
+	{
+	case VisualizationMethod::FinalColor:
+		return m_pTexture->Sample(m_pGBuffer->GetUV(px + (py * m_Width)));
+	case VisualizationMethod::DepthBuffer:
+	{
+		const float remapedBufferVal{ m_Camera.LinearizeDepth(m_pDepthBuffer->GetDepth(px, py)) };
+		return ColorRGB{ remapedBufferVal, remapedBufferVal, remapedBufferVal };
+	}
+	}
+
+	return colors::Black;
+}
+
+bool Renderer::FitsTriangleIds(const std::vector<Mesh>& meshes)
+{
+	// past these the mesh index and the index offset would overlap and ids alias another mesh's triangle
+	if (meshes.size() > MaxTriangleIdMeshes)
+		return false;
+
+	for (const Mesh& mesh : meshes)
+	{
+		if (mesh.indices.size() > TriangleIdIndexMask)
+			return false;
+	}
+
+	return true;
+}
+
+ColorRGB Renderer::ShadeVisibilityPixel(int px, int py, const std::vector<Mesh>& meshes, uint32_t triangleId) const
+{
+	if (m_VisualizationMethod == VisualizationMethod::DepthBuffer)
+	{
+		const float remapedBufferVal{ m_Camera.LinearizeDepth(m_pDepthBuffer->GetDepth(px, py)) };
+		return ColorRGB{ remapedBufferVal, remapedBufferVal, remapedBufferVal };
+	}
+
+	// Unpack the id written by the rasterizer, see RenderTrianglesMesh
+	const Mesh& mesh{ meshes[triangleId >> TriangleIdIndexBits] };
+	const size_t vertIdx{ (triangleId & TriangleIdIndexMask) - 1 };
+	const bool swapVerts{ mesh.primitiveTopology == PrimitiveTopology::TriangleStrip && vertIdx % 2 };
+
+	const uint32_t vertIdx0{ mesh.indices[vertIdx + swapVerts * 2] };
+	const uint32_t vertIdx1{ mesh.indices[vertIdx + 1] };
+	const uint32_t vertIdx2{ mesh.indices[vertIdx + !swapVerts * 2] };
+
+	// positions from the vertex stage, attributes straight from the mesh since no varyings got packed
+	const Vertex_Out& vert0{ mesh.vertices_out[vertIdx0] };
+	const Vertex_Out& vert1{ mesh.vertices_out[vertIdx1] };
+	const Vertex_Out& vert2{ mesh.vertices_out[vertIdx2] };
+
+	// Reconstruct the barycentrics the same way the rasterizer computed them
+	const Vector2 posVert0{ vert0.position.GetXY() };
+	const Vector2 posVert1{ vert1.position.GetXY() };
+	const Vector2 posVert2{ vert2.position.GetXY() };
+
+	const Vector2 pixel{ static_cast<float>(px), static_cast<float>(py) };
+	const float areaTriangle{ std::abs(Vector2::Cross(posVert1 - posVert0, posVert2 - posVert0)) };
+
+	const float weight0{ Vector2::Cross(posVert2 - posVert1, pixel - posVert1) / areaTriangle };
+	const float weight1{ Vector2::Cross(posVert0 - posVert2, pixel - posVert2) / areaTriangle };
+	const float weight2{ Vector2::Cross(posVert1 - posVert0, pixel - posVert0) / areaTriangle };
+
+	const float wV0{ vert0.position.w };
+	const float wV1{ vert1.position.w };
+	const float wV2{ vert2.position.w };
+
+	const float depthInterpolated
+	{
+		1.f / ((1.f / wV0) * weight0 +
+		(1.f / wV1) * weight1 +
+		(1.f / wV2) * weight2)
+	};
+
+	const Vector2 pixelUV = {
+		((mesh.vertices[vertIdx0].uv / wV0) * weight0 +
+			(mesh.vertices[vertIdx1].uv / wV1) * weight1 +
+			(mesh.vertices[vertIdx2].uv / wV2) * weight2) * depthInterpolated
+	};
+
+	return m_pTexture->Sample(pixelUV);
+}
+
+uint32_t Renderer::CountCoveredPixels() const
+{
+	// counted after the fact, a pixel is covered when its depth isn't the clear value anymore
+	uint32_t coveredPixels{};
+	const float clearDepth{ m_pDepthBuffer->GetClearDepth() };
+	for (int py{}; py < m_Height; ++py)
+	{
+		for (int px{}; px < m_Width; ++px)
+		{
+			if (m_pDepthBuffer->GetDepth(px, py) != clearDepth)
+				++coveredPixels;
+		}
+	}
+
+	return coveredPixels;
 }
 
 void Renderer::VertexTransformationFunction(const std::vector<Vertex>& vertices_in, std::vector<Vertex>& vertices_out) const
@@ -99,7 +427,7 @@ void Renderer::VertexTransformationFunction(const std::vector<Vertex>& vertices_
 	for (const auto& vert_in : vertices_in)
 	{
 		Vertex vert_out{};
-		vert_out.position = m_Camera.invViewMatrix.TransformPoint(vert_in.position);
+		vert_out.position = m_Camera.viewMatrix.TransformPoint(vert_in.position);
 
 		vert_out.position.x = vert_out.position.x / vert_out.position.z / (m_Camera.fov * m_AspectRatio);
 		vert_out.position.y = vert_out.position.y / vert_out.position.z / (m_Camera.fov);
@@ -112,42 +440,241 @@ void Renderer::VertexTransformationFunction(const std::vector<Vertex>& vertices_
 void Renderer::VertexTransformationFunction(std::vector<Mesh>& meshes) const
 {
 	// W7 Projection
+	PROFILE_SCOPE("Vertex transform");
 
 	for (auto& mesh : meshes)
 	{
-		mesh.vertices_out.clear();
-		mesh.vertices_out.reserve(mesh.vertices.size());
+		// only the vertices of visible clusters get written below, and those are the only ones the raster stage reads
+		mesh.vertices_out = m_pFrameArena->AllocateUninitialized<Vertex_Out>(mesh.vertices.size());
+
+		const Matrix& wvProjectionMatrix{ mesh.worldViewProjection };
 
-		Matrix wvProjectionMatrix = mesh.worldMatrix * m_Camera.viewMatrix * m_Camera.projectionMatrix;
+		// only the varyings this pipeline reads get written, packed right after each other
+		const VaryingLayout layout{ GetVaryingLayout(m_RenderMode, m_VisualizationMethod) };
+		mesh.varyings_out = m_pFrameArena->AllocateUninitialized<float>(mesh.vertices.size() * layout.nrFloats);
 
-		for (auto const& vert_in : mesh.vertices)
+		// Only vertices of clusters that survived culling get transformed, a vertex shared
+		// by two visible clusters is simply done twice. The positions of a cluster are gathered
+		// first so the whole cluster goes through Matrix::TransformPoints in one batch
+		const auto transformVisibleClusters = [this, &mesh](const Matrix& matrix, const auto& getPosition, const auto& packVaryings)
 		{
-			// for every vert input in the mesh
-			Vertex_Out vert_out{};
+			Vector3 positions[MaxClusterVertices];
+			Vector4 clipPositions[MaxClusterVertices];
+
+			for (const uint32_t clusterIdx : mesh.visibleClusters_out)
+			{
+				const MeshCluster& cluster{ mesh.clusters[clusterIdx] };
+				const uint32_t* pVertexIndices{ mesh.clusterVertexIndices.data() + cluster.firstVertex };
+
+				for (uint32_t i{}; i < cluster.vertexCount; ++i)
+				{
+					positions[i] = getPosition(pVertexIndices[i]);
+				}
+
+				matrix.TransformPoints(std::span<const Vector3>{ positions, cluster.vertexCount }, clipPositions);
+
+				for (uint32_t i{}; i < cluster.vertexCount; ++i)
+				{
+					// NDC space*****
+					Vertex_Out vert_out{};
+					vert_out.position = clipPositions[i];
+
+					vert_out.position.x /= vert_out.position.w;
+					vert_out.position.y /= vert_out.position.w;
+					vert_out.position.z /= vert_out.position.w;
+
+					packVaryings(pVertexIndices[i], 1.f / vert_out.position.w);
+					// straight to screen space, vertices of culled clusters are never written so nothing else may touch them
+					mesh.vertices_out[pVertexIndices[i]] = ConvertFromNDCtoScreen(vert_out);
+				}
+			}
+		};
+
+		if (!mesh.quantizedVertices.empty())
+		{
+			// The dequantization (min + position * scale) is folded into the matrix,
+			// so the 16-bit positions only need an int to float conversion
+			const Matrix quantizedProjectionMatrix{
+				Matrix::CreateScale(mesh.quantizationScale) * Matrix::CreateTranslation(mesh.quantizationMin) * wvProjectionMatrix };
+
+			transformVisibleClusters(quantizedProjectionMatrix,
+				[&](uint32_t vertexIdx)
+				{
+					const QuantizedVertex& quantized{ mesh.quantizedVertices[vertexIdx] };
+					return Vector3{ static_cast<float>(quantized.position[0]), static_cast<float>(quantized.position[1]), static_cast<float>(quantized.position[2]) };
+				},
+				[&](uint32_t vertexIdx, float invW)
+				{
+					layout.Pack(mesh.quantizedVertices[vertexIdx], invW, mesh.varyings_out.data() + vertexIdx * layout.nrFloats);
+				});
+			continue;
+		}
+
+		transformVisibleClusters(wvProjectionMatrix,
+			[&](uint32_t vertexIdx)
+			{
+				return mesh.vertices[vertexIdx].position;
+			},
+			[&](uint32_t vertexIdx, float invW)
+			{
+				layout.Pack(mesh.vertices[vertexIdx], invW, mesh.varyings_out.data() + vertexIdx * layout.nrFloats);
+			});
+	}
+
+}
+
+void Renderer::UpdateWorldViewProjections(std::vector<Mesh>& meshes) const
+{
+	// Only meshes that moved, or all of them when the camera did, pay for the multiply
+	for (auto& mesh : meshes)
+	{
+		if (mesh.worldViewProjectionVersion == m_Camera.matrixVersion && mesh.worldViewProjectionWorld == mesh.worldMatrix)
+			continue;
 
+		mesh.worldViewProjection = mesh.worldMatrix * m_Camera.viewProjectionMatrix;
+		mesh.worldViewProjectionWorld = mesh.worldMatrix;
+		mesh.worldViewProjectionVersion = m_Camera.matrixVersion;
+	}
+}
+
+void Renderer::RenderOcclusionPass(const std::vector<Mesh>& meshes)
+{
+	m_HasOccluders = false;
+	if (!m_UseOcclusionCulling)
+		return;
 
-			/*vert_out.position = { m_Camera.invViewMatrix.TransformPoint(vert_in.position), 0 };
+	PROFILE_SCOPE("Occlusion pass");
+	const uint64_t startTime{ SDL_GetPerformanceCounter() };
 
-			vert_out.position.x = vert_out.position.x / vert_out.position.z / (m_Camera.fov * m_AspectRatio);
-			vert_out.position.y = vert_out.position.y / vert_out.position.z / (m_Camera.fov);
-			mesh.vertices_out.emplace_back(vert_out);*/
+	m_pOcclusionBuffer->Clear(m_Camera.isReversedZ);
 
-			// NDC space*****
-			vert_out.position = wvProjectionMatrix.TransformPoint({ vert_in.position, 1.0f });
+	for (const auto& mesh : meshes)
+	{
+		if (!mesh.isOccluder)
+			continue;
 
-			vert_out.position.x /= vert_out.position.w;
-			vert_out.position.y /= vert_out.position.w;
-			vert_out.position.z /= vert_out.position.w;
+		m_HasOccluders = true;
+		const Matrix& wvProjectionMatrix{ mesh.worldViewProjection };
 
-			vert_out.color = vert_in.color;
-			vert_out.normal = vert_in.normal;
-			vert_out.uv = vert_in.uv;
-			vert_out.tangent = vert_in.tangent;
+		// occluders are meant to be simple, every triangle gets transformed here
+		for (size_t triangleIdx{}; triangleIdx < GetTriangleCount(mesh); ++triangleIdx)
+		{
+			const size_t vertIdx{ GetTriangleIndexOffset(mesh, triangleIdx) };
 
-			mesh.vertices_out.emplace_back(vert_out);
+			m_pOcclusionBuffer->RasterizeTriangle(
+				wvProjectionMatrix.TransformPoint({ mesh.vertices[mesh.indices[vertIdx]].position, 1.f }),
+				wvProjectionMatrix.TransformPoint({ mesh.vertices[mesh.indices[vertIdx + 1]].position, 1.f }),
+				wvProjectionMatrix.TransformPoint({ mesh.vertices[mesh.indices[vertIdx + 2]].position, 1.f }));
 		}
 	}
 
+	if (m_HasOccluders)
+		m_pOcclusionBuffer->BuildPyramid();
+
+	m_FrameStats.occlusionPassMs = static_cast<float>(SDL_GetPerformanceCounter() - startTime) * 1000.f / static_cast<float>(SDL_GetPerformanceFrequency());
+}
+
+std::span<const DrawItem> Renderer::BuildRenderQueue(const std::vector<Mesh>& meshes)
+{
+	PROFILE_SCOPE("Render queue");
+
+	const std::span<DrawItem> renderQueue{ m_pFrameArena->AllocateUninitialized<DrawItem>(meshes.size()) };
+
+	size_t nrDraws{};
+	for (uint32_t meshIdx{}; meshIdx < meshes.size(); ++meshIdx)
+	{
+		const Mesh& mesh{ meshes[meshIdx] };
+
+		// everything got culled, nothing to draw
+		if (mesh.visibleClusters_out.empty())
+			continue;
+
+		// view depth of the center of the bounds
+		const Vector3 center{ mesh.worldMatrix.TransformPoint(mesh.boundsCenter) };
+		const float viewDepth{ Vector3::Dot(center - m_Camera.origin, m_Camera.forward) };
+
+		renderQueue[nrDraws++] = DrawItem{ MakeOpaqueSortKey(viewDepth, m_Camera.nearVP, m_Camera.farVP, mesh.materialId), meshIdx };
+	}
+
+	if (m_SortDraws)
+		RadixSort(renderQueue.first(nrDraws), m_pFrameArena->AllocateUninitialized<DrawItem>(nrDraws));
+
+	return renderQueue.first(nrDraws);
+}
+
+bool Renderer::IsOccluded(const Matrix& wvProjectionMatrix, const Vector3& center, float radius) const
+{
+	// Screen box and nearest depth of the corners of the box around the sphere
+	Vector2 ndcMin{ FLT_MAX, FLT_MAX };
+	Vector2 ndcMax{ -FLT_MAX, -FLT_MAX };
+	float nearestDepth{ m_Camera.isReversedZ ? -FLT_MAX : FLT_MAX };
+
+	for (int corner{}; corner < 8; ++corner)
+	{
+		const Vector3 position{
+			center.x + ((corner & 1) ? radius : -radius),
+			center.y + ((corner & 2) ? radius : -radius),
+			center.z + ((corner & 4) ? radius : -radius) };
+
+		const Vector4 clip{ wvProjectionMatrix.TransformPoint({ position, 1.f }) };
+
+		// reaches behind the camera, can't be projected so assume it's visible
+		if (clip.w <= 0.f)
+			return false;
+
+		const Vector2 ndc{ clip.x / clip.w, clip.y / clip.w };
+		ndcMin = Vector2::Min(ndcMin, ndc);
+		ndcMax = Vector2::Max(ndcMax, ndc);
+
+		const float depth{ clip.z / clip.w };
+		nearestDepth = m_Camera.isReversedZ ? std::max(nearestDepth, depth) : std::min(nearestDepth, depth);
+	}
+
+	return m_pOcclusionBuffer->IsOccluded(ndcMin, ndcMax, nearestDepth);
+}
+
+void Renderer::CullClusters(std::vector<Mesh>& meshes)
+{
+	PROFILE_SCOPE("Cluster culling");
+
+	for (auto& mesh : meshes)
+	{
+		mesh.visibleClusters_out = m_pFrameArena->AllocateUninitialized<uint32_t>(mesh.clusters.size());
+
+		const Matrix& wvProjectionMatrix{ mesh.worldViewProjection };
+		const ClusterCuller culler{ wvProjectionMatrix, mesh.worldMatrix, m_Camera.origin };
+
+		// occluders would hide themselves
+		const bool testOcclusion{ m_UseOcclusionCulling && m_HasOccluders && !mesh.isOccluder };
+		if (testOcclusion && IsOccluded(wvProjectionMatrix, mesh.boundsCenter, mesh.boundsRadius))
+		{
+			++m_FrameStats.occludedMeshes;
+			m_FrameStats.occludedClusters += static_cast<uint32_t>(mesh.clusters.size());
+			mesh.visibleClusters_out = {};
+			continue;
+		}
+
+		size_t nrVisible{};
+		for (uint32_t clusterIdx{}; clusterIdx < mesh.clusters.size(); ++clusterIdx)
+		{
+			const MeshCluster& cluster{ mesh.clusters[clusterIdx] };
+			if (m_UseClusterCulling && !culler.IsVisible(cluster))
+			{
+				++m_FrameStats.culledClusters;
+				continue;
+			}
+
+			if (testOcclusion && IsOccluded(wvProjectionMatrix, cluster.boundsCenter, cluster.boundsRadius))
+			{
+				++m_FrameStats.occludedClusters;
+				continue;
+			}
+
+			mesh.visibleClusters_out[nrVisible++] = clusterIdx;
+		}
+
+		mesh.visibleClusters_out = mesh.visibleClusters_out.first(nrVisible);
+	}
 }
 
 
@@ -172,16 +699,13 @@ void dae::Renderer::RenderW6()
 	std::vector<Vertex> verts_ndc;
 	VertexTransformationFunction(verts_world, verts_ndc);
 
-	std::vector<Vector2> screenVerts;
-	screenVerts.reserve(verts_ndc.size());
-	for (const auto& vertexNdc : verts_ndc)
+	const std::span<Vector2> screenVerts{ m_pFrameArena->AllocateUninitialized<Vector2>(verts_ndc.size()) };
+	for (size_t vertIdx{}; vertIdx < verts_ndc.size(); ++vertIdx)
 	{
-		screenVerts.emplace_back(
-			Vector2{
-				(vertexNdc.position.x + 1) * 0.5f * static_cast<float>(m_Width),
-				(1 - vertexNdc.position.y) * 0.5f * static_cast<float>(m_Height)
-			}
-		);
+		screenVerts[vertIdx] = Vector2{
+			(verts_ndc[vertIdx].position.x + 1) * 0.5f * static_cast<float>(m_Width),
+			(1 - verts_ndc[vertIdx].position.y) * 0.5f * static_cast<float>(m_Height)
+		};
 	}
 	const Vector2 screenVector{ static_cast<float>(m_Width), static_cast<float>(m_Height) };
 	for (size_t triIdx{}; triIdx < screenVerts.size(); triIdx += 3)
@@ -195,7 +719,6 @@ void dae::Renderer::RenderW6()
 		{
 			for (int py{ static_cast<int>(boundingBoxMin.y) }; py < boundingBoxMax.y; ++py)
 			{
-				const int pixelIdx{ px + py * m_Width };
 				const Vector2 pixelCoordinates{ static_cast<float>(px), static_cast<float>(py) };
 				float signedAreaV0V1;
 				float signedAreaV1V2;
@@ -218,8 +741,8 @@ void dae::Renderer::RenderW6()
 						(verts_world[triIdx + 2].position.z - m_Camera.origin.z) * weightV2
 					};
 
-					if (m_pDepthBufferPixels[pixelIdx] < depthWeight) continue;
-					m_pDepthBufferPixels[pixelIdx] = depthWeight;
+					// W6 depth is a view distance, bring it in the [0, 1] range the depth buffer expects
+					if (!m_pDepthBuffer->TestAndWrite(px, py, depthWeight / m_Camera.farVP)) continue;
 					ColorRGB finalColor =
 					{
 						verts_world[triIdx].color * weightV0 +
@@ -229,12 +752,7 @@ void dae::Renderer::RenderW6()
 
 
 					//Update Color in Buffer
-					finalColor.MaxToOne();
-
-					m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-						static_cast<uint8_t>(finalColor.r * 255),
-						static_cast<uint8_t>(finalColor.g * 255),
-						static_cast<uint8_t>(finalColor.b * 255));
+					WritePixel(px, py, m_PixelPacker.Pack(finalColor));
 				}
 			}
 		}
@@ -243,116 +761,245 @@ void dae::Renderer::RenderW6()
 
 void dae::Renderer::RenderW7()
 {
-	// Define Mesh
-	std::vector<Mesh> meshes_world
-	{
-		Mesh{
-			{
-				// Verts (not vert outs, those are still empty)
-				Vertex{{-3, 3, -2}, colors::White, Vector2{0,0}},
-				Vertex{{0, 3, -2}, colors::White, Vector2{.5f,0}},
-				Vertex{{3, 3, -2}, colors::White, Vector2{1.f,0}},
-				Vertex{{-3, 0, -2}, colors::White, Vector2{0,.5f}},
-				Vertex{{0, 0, -2}, colors::White, Vector2{.5f,.5f}},
-				Vertex{{3, 0, -2}, colors::White, Vector2{1.f,.5f}},
-				Vertex{{-3, -3, -2}, colors::White, Vector2{0,1.f}},
-				Vertex{{0, -3, -2}, colors::White, Vector2{.5f,1.f}},
-				Vertex{{3, -3, -2}, colors::White, Vector2{1.f,1.f}}
-				},
-		{
-			// Indices
-			3,0,4,1,5,2,
-			2,6,
-			6,3,7,4,8,5
-		},
-		// Primitive topology
-		PrimitiveTopology::TriangleStrip
-		}
-	};
+	std::vector<Mesh>& meshes_world{ m_Meshes };
 
-	// Define Mesh
-	//std::vector<Mesh> meshes_world
-	//{
-	//	Mesh{
-	//		{
-		//Vertex{ {-3, 3, -2}, colors::White, Vector2{0,0} },
-		//Vertex{ {0, 3, -2}, colors::White, Vector2{.5f,0} },
-		//Vertex{ {3, 3, -2}, colors::White, Vector2{1.f,0} },
-		//Vertex{ {-3, 0, -2}, colors::White, Vector2{0,.5f} },
-		//Vertex{ {0, 0, -2}, colors::White, Vector2{.5f,.5f} },
-		//Vertex{ {3, 0, -2}, colors::White, Vector2{1.f,.5f} },
-		//Vertex{ {-3, -3, -2}, colors::White, Vector2{0,1.f} },
-		//Vertex{ {0, -3, -2}, colors::White, Vector2{.5f,1.f} },
-		//Vertex{ {3, -3, -2}, colors::White, Vector2{1.f,1.f} }
-	//			},
-	//	{
-	//		3,0,1,	1,4,3,	4,1,2,
-	//		2,5,4,	6,3,4,	4,7,6,
-	//		7,4,5,	5,8,7
-	//	},
-	//	PrimitiveTopology::TriangleList
-	//	}
-	//};
+	UpdateWorldViewProjections(meshes_world);
+
+	// Whole meshes and clusters are dropped before the vertex stage
+	RenderOcclusionPass(meshes_world);
+	CullClusters(meshes_world);
 
-	// Changes the vert outs
+	// Changes the vert outs, they come out in screen space
 	VertexTransformationFunction(meshes_world);
 
-	for (auto& mesh : meshes_world)
-	{
-		//VertexTransformationFunction(mesh.vertices, vertices_ndc);
-
-		//std::vector<Vertex> verts_ndc;
-		//std::vector<Vector2> screen_verts;
-		//
-		//screen_verts.reserve(verts_ndc.size());
-		//for (const auto& vert : verts_ndc)
-		//{
-		//	screen_verts.emplace_back(
-		//		Vector2{
-		//			// NDC
-		//			(vert.position.x + 1) * 0.5f * m_Width,
-		//			(1 - vert.position.y) * 0.5f * m_Height
-		//
-		//		}
-		//	);
-		//}
-
-		for (auto& vert : mesh.vertices_out)
+	const std::span<const DrawItem> renderQueue{ BuildRenderQueue(meshes_world) };
+
+	const uint64_t rasterStartTime{ SDL_GetPerformanceCounter() };
+
+	// Depth only first, the color pass then only shades the fragments that ended up on top
+	if (m_RenderMode == RenderMode::DepthPrePass)
+	{
+		PROFILE_SCOPE("Depth pre-pass");
+		for (const DrawItem& draw : renderQueue)
 		{
-			// for every vert out
-			// that is projected via Vertextransformationfunction
+			RenderMesh(meshes_world[draw.meshIdx], 0, true);
+		}
+	}
 
-			// convert from NDC to screen space
-			vert = ConvertFromNDCtoScreen(vert);
+	// the mesh index stays the one in the scene, the visibility buffer stores it.
+	// Forward modes shade while rasterizing, so that's part of this scope too
+	{
+		PROFILE_SCOPE("Rasterization");
+		for (const DrawItem& draw : renderQueue)
+		{
+			RenderMesh(meshes_world[draw.meshIdx], draw.meshIdx, false);
 		}
+	}
+
+	m_FrameStats.rasterMs = static_cast<float>(SDL_GetPerformanceCounter() - rasterStartTime) * 1000.f / static_cast<float>(SDL_GetPerformanceFrequency());
+
+	if (m_RenderMode == RenderMode::Deferred || m_RenderMode == RenderMode::VisibilityBuffer)
+		ShadeDeferred(meshes_world);
+}
+
+// Index layout: ((visualization * NrRenderModes + renderMode) * NrDepthFormats + depthFormat) * NrTopologies + topology
+template<size_t... Indices>
+constexpr std::array<Renderer::DrawFunction, sizeof...(Indices)> Renderer::MakeDrawTable(std::index_sequence<Indices...>)
+{
+	return { &Renderer::RenderMeshKernel<true,
+		static_cast<VisualizationMethod>(Indices / (NrTopologies * NrDepthFormats * NrRenderModes)),
+		static_cast<RenderMode>((Indices / (NrTopologies * NrDepthFormats)) % NrRenderModes),
+		static_cast<DepthFormat>((Indices / NrTopologies) % NrDepthFormats),
+		static_cast<PrimitiveTopology>(Indices % NrTopologies)>... };
+}
+
+template<size_t... Indices>
+constexpr std::array<Renderer::DrawFunction, sizeof...(Indices)> Renderer::MakeDepthOnlyTable(std::index_sequence<Indices...>)
+{
+	return { &Renderer::RenderMeshDepthOnlyKernel<
+		static_cast<DepthFormat>(Indices / NrTopologies),
+		static_cast<PrimitiveTopology>(Indices % NrTopologies)>... };
+}
 
-		switch (mesh.primitiveTopology)
+void dae::Renderer::RenderMesh(const Mesh& mesh, uint32_t meshIdx, bool depthOnly)
+{
+	// Pick the kernel once per draw, the pipeline state is baked into it at compile time
+	const size_t topologyIdx{ static_cast<size_t>(mesh.primitiveTopology) };
+	const size_t formatIdx{ static_cast<size_t>(m_pDepthBuffer->GetFormat()) };
+
+	if (depthOnly)
+	{
+		static constexpr auto depthOnlyTable{ MakeDepthOnlyTable(std::make_index_sequence<NrDepthFormats * NrTopologies>{}) };
+		(this->*depthOnlyTable[formatIdx * NrTopologies + topologyIdx])(mesh, meshIdx);
+		return;
+	}
+
+	if (!m_UseSpecializedKernels)
+	{
+		// Specialized == false ignores the other template arguments, the kernel reads the pipeline state at runtime
+		RenderMeshKernel<false, VisualizationMethod::FinalColor, RenderMode::Forward, DepthFormat::D32Float, PrimitiveTopology::TriangleList>(mesh, meshIdx);
+		return;
+	}
+
+	static constexpr auto drawTable{ MakeDrawTable(std::make_index_sequence<NrVisualizationMethods * NrRenderModes * NrDepthFormats * NrTopologies>{}) };
+
+	const size_t visualizationIdx{ static_cast<size_t>(m_VisualizationMethod) };
+	const size_t renderModeIdx{ static_cast<size_t>(m_RenderMode) };
+
+	(this->*drawTable[((visualizationIdx * NrRenderModes + renderModeIdx) * NrDepthFormats + formatIdx) * NrTopologies + topologyIdx])(mesh, meshIdx);
+}
+
+template<bool Specialized, Renderer::VisualizationMethod Visualization, Renderer::RenderMode Mode, DepthFormat Format, PrimitiveTopology Topology>
+void dae::Renderer::RenderMeshKernel(const Mesh& mesh, uint32_t meshIdx)
+{
+	const PrimitiveTopology topology{ Specialized ? Topology : mesh.primitiveTopology };
+
+	for (const uint32_t clusterIdx : mesh.visibleClusters_out)
+	{
+		const MeshCluster& cluster{ mesh.clusters[clusterIdx] };
+		const size_t lastTriangle{ cluster.firstTriangle + cluster.triangleCount };
+		m_FrameStats.submittedTriangles += cluster.triangleCount;
+
+		switch (topology)
 		{
 		case PrimitiveTopology::TriangleStrip:
-			for (size_t vertIdx{}; vertIdx < mesh.indices.size() - 2; ++vertIdx)
+			for (size_t vertIdx{ cluster.firstTriangle }; vertIdx < lastTriangle; ++vertIdx)
 			{
-				RenderTrianglesMesh(mesh, mesh.vertices_out, mesh.vertices, vertIdx, vertIdx % 2);
+				RenderTrianglesMesh<Specialized, Visualization, Mode, Format>(mesh, vertIdx, vertIdx % 2, meshIdx);
 			}
 			break;
 		case PrimitiveTopology::TriangleList:
-			for (size_t vertIdx{}; vertIdx < mesh.indices.size() - 2; vertIdx += 3)
+			for (size_t vertIdx{ cluster.firstTriangle * size_t{ 3 } }; vertIdx < lastTriangle * 3; vertIdx += 3)
 			{
-				RenderTrianglesMesh(mesh, mesh.vertices_out, mesh.vertices, vertIdx);
+				RenderTrianglesMesh<Specialized, Visualization, Mode, Format>(mesh, vertIdx, false, meshIdx);
 			}
 			break;
 		}
+	}
+}
 
-		//for (int vertIdx{}; vertIdx < mesh.indices.size(); ++vertIdx)
-		//{
-		//	RenderTrianglesMesh(mesh, mesh.vertices_out, mesh.vertices, vertIdx);
-		//}
-		
+template<DepthFormat Format, PrimitiveTopology Topology>
+void dae::Renderer::RenderMeshDepthOnlyKernel(const Mesh& mesh, uint32_t)
+{
+	// same clusters as the color pass, otherwise the equal test there wouldn't line up
+	for (const uint32_t clusterIdx : mesh.visibleClusters_out)
+	{
+		const MeshCluster& cluster{ mesh.clusters[clusterIdx] };
+		const size_t lastTriangle{ cluster.firstTriangle + cluster.triangleCount };
+
+		if constexpr (Topology == PrimitiveTopology::TriangleStrip)
+		{
+			for (size_t vertIdx{ cluster.firstTriangle }; vertIdx < lastTriangle; ++vertIdx)
+			{
+				RenderTriangleDepthOnly<Format>(mesh, vertIdx, vertIdx % 2);
+			}
+		}
+		else
+		{
+			for (size_t vertIdx{ cluster.firstTriangle * size_t{ 3 } }; vertIdx < lastTriangle * 3; vertIdx += 3)
+			{
+				RenderTriangleDepthOnly<Format>(mesh, vertIdx, false);
+			}
+		}
 	}
+}
+
+template<DepthFormat Format>
+void dae::Renderer::RenderTriangleDepthOnly(const Mesh& mesh, size_t vertIdx, bool swapVerts)
+{
+	// Stripped down RenderTrianglesMesh, same coverage and depth math so the color pass
+	// can use an equal test, but no attributes and no texture access
+	const auto vertIdx0{ mesh.indices[vertIdx + swapVerts * 2] };
+	const auto vertIdx1{ mesh.indices[vertIdx + 1] };
+	const auto vertIdx2{ mesh.indices[vertIdx + !swapVerts * 2] };
+
+	if (vertIdx0 == vertIdx1 || vertIdx1 == vertIdx2 || vertIdx2 == vertIdx0) return;
+
+	const Vector4& position0{ mesh.vertices_out[vertIdx0].position };
+	const Vector4& position1{ mesh.vertices_out[vertIdx1].position };
+	const Vector4& position2{ mesh.vertices_out[vertIdx2].position };
+
+	const Vector2 posVert0{ position0.GetXY() };
+	const Vector2 posVert1{ position1.GetXY() };
+	const Vector2 posVert2{ position2.GetXY() };
+
+	const Vector2 edge01{ posVert1 - posVert0 };
+	const Vector2 edge12{ posVert2 - posVert1 };
+	const Vector2 edge20{ posVert0 - posVert2 };
+
+	const float areaTriangle{ std::abs(Vector2::Cross(posVert1 - posVert0, posVert2 - posVert0)) };
+
+	if (areaTriangle <= 0.01f)
+		return;
+
+	const TrianglePlaneSetup planeSetup{ posVert0, posVert1, posVert2 };
+	const PlaneEquation depthPlane{ planeSetup.Create(position0.z, position1.z, position2.z) };
+
+	const int bbBottom = std::min(static_cast<int>(std::min(posVert0.y, posVert1.y)), static_cast<int>(posVert2.y));
+	const int bbTop = std::max(static_cast<int>(std::max(posVert0.y, posVert1.y)), static_cast<int>(posVert2.y)) + 1;
+
+	const int bbLeft = std::min(static_cast<int>(std::min(posVert0.x, posVert1.x)), static_cast<int>(posVert2.x));
+	const int bbRight = std::max(static_cast<int>(std::max(posVert0.x, posVert1.x)), static_cast<int>(posVert2.x)) + 1;
+
+	if (bbLeft <= 0 || bbRight >= m_Width - 1)
+		return;
 
+	if (bbBottom <= 0 || bbTop >= m_Height - 1)
+		return;
+
+	const float triangleMinDepth{ std::min({ position0.z, position1.z, position2.z }) };
+	const float triangleMaxDepth{ std::max({ position0.z, position1.z, position2.z }) };
+
+	for (int tileY{ bbBottom >> DepthBuffer::TileShift }; tileY <= (bbTop - 1) >> DepthBuffer::TileShift; ++tileY)
+	{
+		const int blockTop{ std::max(tileY << DepthBuffer::TileShift, bbBottom) };
+		const int blockBottom{ std::min((tileY + 1) << DepthBuffer::TileShift, bbTop) };
+
+		for (int tileX{ bbLeft >> DepthBuffer::TileShift }; tileX <= (bbRight - 1) >> DepthBuffer::TileShift; ++tileX)
+		{
+			const int blockLeft{ std::max(tileX << DepthBuffer::TileShift, bbLeft) };
+			const int blockRight{ std::min((tileX + 1) << DepthBuffer::TileShift, bbRight) };
+
+			if (m_UseHierarchicalZ)
+			{
+				const float left{ static_cast<float>(blockLeft) };
+				const float top{ static_cast<float>(blockTop) };
+				const float right{ static_cast<float>(blockRight - 1) };
+				const float bottom{ static_cast<float>(blockBottom - 1) };
+
+				if (m_pDepthBuffer->IsTileHidden<Format>(tileX, tileY,
+					std::max(depthPlane.GetMin(left, top, right, bottom), triangleMinDepth),
+					std::min(depthPlane.GetMax(left, top, right, bottom), triangleMaxDepth)))
+				{
+					++m_FrameStats.rejectedBlocks;
+					continue;
+				}
+			}
+
+			for (int py{ blockTop }; py < blockBottom; ++py)
+			{
+				for (int px{ blockLeft }; px < blockRight; ++px)
+				{
+					const Vector2 pixel = { static_cast<float>(px), static_cast<float>(py) };
+
+					if (Vector2::Cross(edge12, pixel - posVert1) < 0) continue;
+					if (Vector2::Cross(edge20, pixel - posVert2) < 0) continue;
+					if (Vector2::Cross(edge01, pixel - posVert0) < 0) continue;
+
+					m_pDepthBuffer->TestAndWrite<Format>(px, py, depthPlane.Evaluate(pixel.x, pixel.y));
+				}
+			}
+		}
+	}
 }
 
-void dae::Renderer::RenderTrianglesMesh(const Mesh& mesh, const std::vector<Vertex_Out>& verts_out, const std::vector<Vertex> verts, size_t vertIdx, bool swapVerts)
+template<bool Specialized, Renderer::VisualizationMethod Visualization, Renderer::RenderMode Mode, DepthFormat Format>
+void dae::Renderer::RenderTrianglesMesh(const Mesh& mesh, size_t vertIdx, bool swapVerts, uint32_t meshIdx)
 {
+	// Specialized kernels get the pipeline state as constants so the per-pixel branches below fold away,
+	// the generic kernel reads it at runtime
+	const VisualizationMethod visualization{ Specialized ? Visualization : m_VisualizationMethod };
+	const RenderMode renderMode{ Specialized ? Mode : m_RenderMode };
 
 	// Set up the proper indices for making the triangles based on the current idx
 	auto vertIdx0{ mesh.indices[vertIdx + swapVerts * 2] };
@@ -392,38 +1039,43 @@ void dae::Renderer::RenderTrianglesMesh(const Mesh& mesh, const std::vector<Vert
 
 
 	// make vert2s out of the vertexes for use with the code further on
-	auto vert0 = mesh.vertices_out[vertIdx0];
-	auto vert1 = mesh.vertices_out[vertIdx1];
-	auto vert2 = mesh.vertices_out[vertIdx2];
+	const Vertex_Out& vert0{ mesh.vertices_out[vertIdx0] };
+	const Vertex_Out& vert1{ mesh.vertices_out[vertIdx1] };
+	const Vertex_Out& vert2{ mesh.vertices_out[vertIdx2] };
 
 	Vector2 posVert0{ vert0.position.GetXY() };
 	Vector2 posVert1{ vert1.position.GetXY() };
 	Vector2 posVert2{ vert2.position.GetXY() };
 
-	// depths
-	const float depthV0{ vert0.position.z };
-	const float depthV1{ vert1.position.z };
-	const float depthV2{ vert2.position.z };
-
 	const float wV0{ vert0.position.w };
 	const float wV1{ vert1.position.w };
 	const float wV2{ vert2.position.w };
 
-	const Vector2 v0uv{ vert0.uv };
-	const Vector2 v1uv{ vert1.uv };
-	const Vector2 v2uv{ vert2.uv };
-
 	const Vector2 edge01{ posVert1 - posVert0 };
 	const Vector2 edge12{ posVert2 - posVert1 };
 	const Vector2 edge20{ posVert0 - posVert2};
 
-	const float areaTriangle{ fabs(Vector2::Cross(posVert1 - posVert0, posVert2 - posVert0)) };
+	const float areaTriangle{ std::abs(Vector2::Cross(posVert1 - posVert0, posVert2 - posVert0)) };
 
 	if (areaTriangle <= 0.01f)
 	{
 		return;
 	}
 
+	// Triangle setup: device z is linear in screen space, attributes are perspective correct as attribute / w,
+	// so per pixel there's only plane evaluations and a single reciprocal for w
+	const TrianglePlaneSetup planeSetup{ posVert0, posVert1, posVert2 };
+	const PlaneEquation depthPlane{ planeSetup.Create(vert0.position.z, vert1.position.z, vert2.position.z) };
+	const PlaneEquation invWPlane{ planeSetup.Create(1.f / wV0, 1.f / wV1, 1.f / wV2) };
+
+	// the packed varyings are already divided by w in the vertex stage
+	const VaryingLayout layout{ GetVaryingLayout(renderMode, visualization) };
+	const float* pVaryings{ mesh.varyings_out.data() };
+
+	PlaneEquation varyingPlanes[VaryingLayout::MaxFloats];
+	planeSetup.Create(pVaryings + vertIdx0 * layout.nrFloats, pVaryings + vertIdx1 * layout.nrFloats,
+		pVaryings + vertIdx2 * layout.nrFloats, layout.nrFloats, varyingPlanes);
+
 	// Setting up bounding box
 	//Vector2 boundingBoxMin{ Vector2::Min(posVert0, Vector2::Min(posVert1, posVert2))};
 	//Vector2 boundingBoxMax{ Vector2::Max(posVert0, Vector2::Max(posVert1, posVert2)) };
@@ -443,137 +1095,164 @@ void dae::Renderer::RenderTrianglesMesh(const Mesh& mesh, const std::vector<Vert
 	if (bbBottom <= 0 || bbTop >= m_Height - 1)
 		return;
 
-	const int offSet{ 0 };
-
-	//for (int px{ static_cast<int>(boundingBoxMin.x) }; px < boundingBoxMax.x; ++px)
-	//{
-	//	for (int py{ static_cast<int>(boundingBoxMin.y) }; py < boundingBoxMax.y; ++py)
-	  //{
-	for (int px{ bbLeft - offSet }; px < bbRight + offSet; ++px)
-		{
-		for (int py{ bbBottom - offSet }; py < bbTop + offSet; ++py)
-		{
-			// Final color variable
-			ColorRGB finalColor{ colors::Black };
+	// An id that doesn't fit would alias another mesh's triangle, such a triangle is dropped rather than shaded wrong.
+	// SwitchRenderMode already refuses the mode for scenes like that, this only catches what slips past it
+	if (renderMode == RenderMode::VisibilityBuffer && (meshIdx >= MaxTriangleIdMeshes || vertIdx + 1 > TriangleIdIndexMask))
+		return;
 
-			Vector2 pixel = { static_cast<float>(px), static_cast<float>(py) };
+	// 0 means empty, so the index is stored + 1
+	const uint32_t triangleId{ (meshIdx << TriangleIdIndexBits) | static_cast<uint32_t>(vertIdx + 1) };
 
-			const auto dir0 = pixel - posVert0;
-			const auto dir1 = pixel - posVert1;
-			const auto dir2 = pixel - posVert2;
+	// Fragments that passed the depth test are gathered so their varyings get interpolated
+	// VaryingBatchSize at a time, then shaded and packed as one batch
+	static_assert(VaryingBatchSize == PixelPacker::BatchSize, "a fragment batch is flushed as one pixel batch");
 
-			//const int pixelIdx{ px + py * m_Width };
-			//const Vector2 pixelCoordinates{ static_cast<float>(px), static_cast<float>(py) };
-			//
-			//float signedAreaVert0_1{}, signedAreaVert1_2{}, signedAreaVert2_0{};
+	float fragmentX[VaryingBatchSize]{};
+	float fragmentY[VaryingBatchSize]{};
+	float fragmentDepth[VaryingBatchSize]{};
+	int pixelBatch[VaryingBatchSize]{};
+	int batchCount{};
 
-			//if (GeometryUtils::IsPointInTriangle(posVert0, posVert1,
-			//	posVert2, pixelCoordinates, signedAreaVert0_1, signedAreaVert1_2, signedAreaVert2_0))
-			//{
+	float varyingBatch[VaryingLayout::MaxFloats * VaryingBatchSize];
+	ColorRGB colorBatch[VaryingBatchSize]{};
 
-				float weight0 = Vector2::Cross(edge12, dir1);
-				if (weight0 < 0) continue;
+	const auto shadeFragmentBatch = [&]()
+	{
+		if (batchCount == 0)
+			return;
 
-				float weight1 = Vector2::Cross(edge20, dir2);
-				if (weight1 < 0) continue;
+		if (layout.nrFloats > 0)
+			InterpolateVaryings(varyingPlanes, layout.nrFloats, invWPlane, fragmentX, fragmentY, varyingBatch);
 
-				float weight2 = Vector2::Cross(edge01, dir0);
-				if (weight2 < 0) continue;
+		const float* pUV{ layout.Has(Varying::UV) ? varyingBatch + layout.GetOffset(Varying::UV) * VaryingBatchSize : nullptr };
 
+		for (int fragmentIdx{}; fragmentIdx < batchCount; ++fragmentIdx)
+		{
+			if (renderMode == RenderMode::Deferred)
+			{
+				// only store the surface, shading happens once per pixel in ShadeDeferred
+				const Vector2 pixelUV{ pUV[fragmentIdx], pUV[VaryingBatchSize + fragmentIdx] };
 
-				//const float triangleArea{ 1.f / (Vector2::Cross(posVert1 - posVert0,
-				//	posVert2 - posVert0)) };
+				m_pGBuffer->Write(pixelBatch[fragmentIdx], pixelUV, mesh.materialId);
+				continue;
+			}
 
-				//const float weightV0{ signedAreaVert1_2 * triangleArea };
-				//const float weightV1{ signedAreaVert2_0 * triangleArea };
-				//const float weightV2{ signedAreaVert0_1 * triangleArea };
+			// switch for changing between with or without depth buffer
+			switch (visualization)
+			{
+			case VisualizationMethod::FinalColor:
+				//sampling the UV coordinates and color
+				colorBatch[fragmentIdx] = m_pTexture->Sample(Vector2{ pUV[fragmentIdx], pUV[VaryingBatchSize + fragmentIdx] });
+				break;
+			case VisualizationMethod::DepthBuffer:
+			{
+				// linearize instead of remapping the top percentile, works for every depth format
+				const float remapedBufferVal{ m_Camera.LinearizeDepth(fragmentDepth[fragmentIdx]) };
+				colorBatch[fragmentIdx] = ColorRGB{ remapedBufferVal, remapedBufferVal , remapedBufferVal };
+				break;
+			}
+			}
+		}
 
-				weight0 /= areaTriangle;
-				weight1 /= areaTriangle;
-				weight2 /= areaTriangle;
+		if (renderMode != RenderMode::Deferred)
+		{
+			m_FrameStats.shadedPixels += batchCount;
+			FlushPixelBatch(colorBatch, pixelBatch, batchCount);
+		}
+		batchCount = 0;
+	};
 
-				const float ZBufferVal{
-						1.f /
-						((1 / depthV0) * weight0 +
-						(1 / depthV1) * weight1 +
-						(1 / depthV2) * weight2)
-				};
+	const float triangleMinDepth{ std::min({ vert0.position.z, vert1.position.z, vert2.position.z }) };
+	const float triangleMaxDepth{ std::max({ vert0.position.z, vert1.position.z, vert2.position.z }) };
 
-				if (ZBufferVal > m_pDepthBufferPixels[px * m_Height + py])
-					continue;
+	// The bounding box gets walked in depth buffer tiles, so a whole tile can be rejected against
+	// its farthest depth before any pixel in it gets tested
+	for (int tileY{ bbBottom >> DepthBuffer::TileShift }; tileY <= (bbTop - 1) >> DepthBuffer::TileShift; ++tileY)
+	{
+		const int blockTop{ std::max(tileY << DepthBuffer::TileShift, bbBottom) };
+		const int blockBottom{ std::min((tileY + 1) << DepthBuffer::TileShift, bbTop) };
 
-				m_pDepthBufferPixels[px * m_Height + py] = ZBufferVal;
+		for (int tileX{ bbLeft >> DepthBuffer::TileShift }; tileX <= (bbRight - 1) >> DepthBuffer::TileShift; ++tileX)
+		{
+			const int blockLeft{ std::max(tileX << DepthBuffer::TileShift, bbLeft) };
+			const int blockRight{ std::min((tileX + 1) << DepthBuffer::TileShift, bbRight) };
 
-				// switch for changing between with or without depth buffer
-				switch (m_VisualizationMethod)
-				{
-				case VisualizationMethod::FinalColor:
+			if (m_UseHierarchicalZ)
+			{
+				// depth range of the triangle over the pixel centers of this block
+				const float left{ static_cast<float>(blockLeft) };
+				const float top{ static_cast<float>(blockTop) };
+				const float right{ static_cast<float>(blockRight - 1) };
+				const float bottom{ static_cast<float>(blockBottom - 1) };
+				const float minDepth{ std::max(depthPlane.GetMin(left, top, right, bottom), triangleMinDepth) };
+				const float maxDepth{ std::min(depthPlane.GetMax(left, top, right, bottom), triangleMaxDepth) };
+
+				const bool isHidden{ Specialized ?
+					m_pDepthBuffer->IsTileHidden<Format>(tileX, tileY, minDepth, maxDepth) :
+					m_pDepthBuffer->IsTileHidden(tileX, tileY, minDepth, maxDepth) };
+
+				if (isHidden)
 				{
-					//sampling the UV coordinates and color
-					const float depthInterpolated
-					{
-						1.f / ((1.f / wV0) * weight0 +
-						(1.f / wV1) * weight1 +
-						(1.f / wV2) * weight2)
-					};
-
-					const Vector2 pixelUV = {
-						((v0uv / wV0) * weight0 +
-							(v1uv / wV1) * weight1 +
-							(v2uv / wV2) * weight2) * depthInterpolated
-					};
-
-					// ERROR************
-					//if (m_pDepthBufferPixels[pixelIdx] < depthInterpolated) continue;
-					//m_pDepthBufferPixels[pixelIdx] = depthInterpolated;
-
-					//Vector2 pixelUV
-					//{
-					//	(mesh.vertices[vertIdx0].uv / depthV0 * weightV0 +
-					//	mesh.vertices[vertIdx1].uv / depthV1 * weightV1 +
-					//	mesh.vertices[vertIdx2].uv / depthV2 * weightV2) * depthInterpolated
-					//};
-
-					finalColor = m_pTexture->Sample(pixelUV);
-					break;
+					++m_FrameStats.rejectedBlocks;
+					continue;
 				}
-				case VisualizationMethod::DepthBuffer:
-				{
-					const float depthRemapSize{ 0.005f };
+			}
 
-					//float remapedBufferVal{ ZBufferVal };
-					//DepthRemap(remapedBufferVal, depthRemapSize);
-					//finalColor = ColorRGB{ remapedBufferVal, remapedBufferVal , remapedBufferVal };
+			for (int py{ blockTop }; py < blockBottom; ++py)
+			{
+				for (int px{ blockLeft }; px < blockRight; ++px)
+				{
+					Vector2 pixel = { static_cast<float>(px), static_cast<float>(py) };
 
-					float remapedBufferVal{ ZBufferVal };
+					const auto dir0 = pixel - posVert0;
+					const auto dir1 = pixel - posVert1;
+					const auto dir2 = pixel - posVert2;
 
-					/*depth = (depth - (1.f - topPercentile)) / topPercentile;
+					if (Vector2::Cross(edge12, dir1) < 0) continue;
+					if (Vector2::Cross(edge20, dir2) < 0) continue;
+					if (Vector2::Cross(edge01, dir0) < 0) continue;
 
-					depth = std::max(0.f, depth);
-					depth = std::min(1.f, depth);*/
+					const float ZBufferVal{ depthPlane.Evaluate(pixel.x, pixel.y) };
 
-					// depth remapping
-					remapedBufferVal = (remapedBufferVal - (1.f - depthRemapSize)) / depthRemapSize;
-					remapedBufferVal = std::max(0.f, remapedBufferVal);
-					remapedBufferVal = std::min(1.f, remapedBufferVal);
+					// after a depth pre-pass the buffer already holds the closest depth, only that fragment gets shaded
+					bool depthPassed{};
+					if constexpr (Specialized)
+					{
+						depthPassed = renderMode == RenderMode::DepthPrePass ?
+							m_pDepthBuffer->TestEqual<Format>(px, py, ZBufferVal) :
+							m_pDepthBuffer->TestAndWrite<Format>(px, py, ZBufferVal);
+					}
+					else
+					{
+						depthPassed = renderMode == RenderMode::DepthPrePass ?
+							m_pDepthBuffer->TestEqual(px, py, ZBufferVal) :
+							m_pDepthBuffer->TestAndWrite(px, py, ZBufferVal);
+					}
 
-					finalColor = ColorRGB{ remapedBufferVal, remapedBufferVal , remapedBufferVal };
-					break;
-				}
-				}
+					if (!depthPassed)
+						continue;
 
-				//Update Color in Buffer
-				finalColor.MaxToOne();
+					if (renderMode == RenderMode::VisibilityBuffer)
+					{
+						// only which triangle is visible, everything else gets reconstructed in ShadeVisibilityPixel
+						TouchColorTile(px, py);
+						m_pTriangleIds[px + (py * m_Width)] = triangleId;
+						continue;
+					}
 
-				m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-					static_cast<uint8_t>(finalColor.r * 255),
-					static_cast<uint8_t>(finalColor.g * 255),
-					static_cast<uint8_t>(finalColor.b * 255));
-			//}
+					TouchColorTile(px, py);
+					fragmentX[batchCount] = pixel.x;
+					fragmentY[batchCount] = pixel.y;
+					fragmentDepth[batchCount] = ZBufferVal;
+					pixelBatch[batchCount] = px + (py * m_Width);
+					if (++batchCount == VaryingBatchSize)
+						shadeFragmentBatch();
+				}
+			}
 		}
 	}
 
-
+	shadeFragmentBatch();
 }
 
 void dae::Renderer::RenderTrianglesMesh(const Mesh& mesh, const std::vector<Vector2>& screenVertices, const std::vector<Vertex> ndcVertices, size_t vertIdx, bool swapVertices)
@@ -604,7 +1283,6 @@ void dae::Renderer::RenderTrianglesMesh(const Mesh& mesh, const std::vector<Vect
 			ColorRGB finalColor{ colors::Black };
 
 
-			const int pixelIdx{ px + py * m_Width };
 			const Vector2 pixelCoordinates{ static_cast<float>(px), static_cast<float>(py) };
 			float signedAreaV0V1{}, signedAreaV1V2{}, signedAreaV2V0{};
 
@@ -635,8 +1313,7 @@ void dae::Renderer::RenderTrianglesMesh(const Mesh& mesh, const std::vector<Vect
 							(1.f / depthV2) * weightV2)
 						};
 
-						if (m_pDepthBufferPixels[pixelIdx] < depthInterpolated) continue;
-						m_pDepthBufferPixels[pixelIdx] = depthInterpolated;
+						if (!m_pDepthBuffer->TestAndWrite(px, py, depthInterpolated)) continue;
 
 						Vector2 pixelUV
 						{
@@ -660,12 +1337,7 @@ void dae::Renderer::RenderTrianglesMesh(const Mesh& mesh, const std::vector<Vect
 					}
 
 				//Update Color in Buffer
-				finalColor.MaxToOne();
-
-				m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-					static_cast<uint8_t>(finalColor.r * 255),
-					static_cast<uint8_t>(finalColor.g * 255),
-					static_cast<uint8_t>(finalColor.b * 255));
+				WritePixel(px, py, m_PixelPacker.Pack(finalColor));
 			}
 		}
 	}
@@ -673,7 +1345,7 @@ void dae::Renderer::RenderTrianglesMesh(const Mesh& mesh, const std::vector<Vect
 
 }
 
-Vertex_Out dae::Renderer::ConvertFromNDCtoScreen(const Vertex_Out& vert_out)
+Vertex_Out dae::Renderer::ConvertFromNDCtoScreen(const Vertex_Out& vert_out) const
 {
 	Vertex_Out vertex{ vert_out };
 
@@ -727,7 +1399,154 @@ void dae::Renderer::SwitchVisualizationMethod()
 	}
 }
 
-bool Renderer::SaveBufferToImage() const
+void dae::Renderer::SwitchDepthFormat()
+{
+	DepthFormat format{ m_pDepthBuffer->GetFormat() };
+
+	switch (format)
+	{
+	case DepthFormat::D32Float:
+		format = DepthFormat::D32FloatReversed;
+		break;
+	case DepthFormat::D32FloatReversed:
+		format = DepthFormat::D24Unorm;
+		break;
+	case DepthFormat::D24Unorm:
+		format = DepthFormat::D16Unorm;
+		break;
+	case DepthFormat::D16Unorm:
+		format = DepthFormat::D32Float;
+		break;
+	}
+
+	SetDepthFormat(format);
+
+	const float MB{ 1024.f * 1024.f };
+	std::cout << "Depth format: " << DepthBuffer::GetFormatName(format)
+		<< " - depth traffic per frame: "
+		<< DepthBuffer::GetFrameTrafficBytes(format, m_Width, m_Height) / MB << " MB (current), "
+		<< DepthBuffer::GetFrameTrafficBytes(format, 1920, 1080) / MB << " MB (1080p), "
+		<< DepthBuffer::GetFrameTrafficBytes(format, 3840, 2160) / MB << " MB (4K)" << std::endl;
+}
+
+void dae::Renderer::SetDepthFormat(DepthFormat format)
+{
+	m_pDepthBuffer->SetFormat(format);
+	m_Camera.isReversedZ = m_pDepthBuffer->IsReversed();
+	m_Camera.CalculateProjectionMatrix();
+}
+
+void dae::Renderer::SwitchRasterKernels()
+{
+	m_UseSpecializedKernels = !m_UseSpecializedKernels;
+	std::cout << "Raster kernels: " << (m_UseSpecializedKernels ? "Specialized" : "Generic") << std::endl;
+}
+
+void dae::Renderer::SwitchClusterCulling()
+{
+	m_UseClusterCulling = !m_UseClusterCulling;
+	std::cout << "Cluster culling: " << (m_UseClusterCulling ? "On" : "Off") << std::endl;
+}
+
+void dae::Renderer::SwitchOcclusionCulling()
+{
+	m_UseOcclusionCulling = !m_UseOcclusionCulling;
+	std::cout << "Occlusion culling: " << (m_UseOcclusionCulling ? "On" : "Off") << std::endl;
+}
+
+void dae::Renderer::SwitchHierarchicalZ()
+{
+	m_UseHierarchicalZ = !m_UseHierarchicalZ;
+	std::cout << "Hierarchical Z: " << (m_UseHierarchicalZ ? "On" : "Off") << std::endl;
+}
+
+void dae::Renderer::SwitchDrawSorting()
+{
+	m_SortDraws = !m_SortDraws;
+	std::cout << "Front to back draw sorting: " << (m_SortDraws ? "On" : "Off") << std::endl;
+}
+
+void dae::Renderer::SwitchVertexFormat()
+{
+	SetQuantizedVertices(!m_UseQuantizedVertices);
+
+	size_t vertexMemory{};
+	size_t floatVertexMemory{};
+	for (const Mesh& mesh : m_Meshes)
+	{
+		vertexMemory += GetVertexMemory(mesh);
+		floatVertexMemory += mesh.vertices.size() * sizeof(Vertex);
+	}
+
+	std::cout << "Vertex format: " << (m_UseQuantizedVertices ? "Quantized" : "Float")
+		<< " - vertex stage reads " << vertexMemory << " bytes (float: " << floatVertexMemory << " bytes)" << std::endl;
+}
+
+void dae::Renderer::SetQuantizedVertices(bool useQuantized)
+{
+	m_UseQuantizedVertices = useQuantized;
+
+	// the float vertices stay around for switching back and for the visibility buffer reconstruction
+	for (Mesh& mesh : m_Meshes)
+	{
+		if (m_UseQuantizedVertices)
+			QuantizeMesh(mesh);
+		else
+			mesh.quantizedVertices.clear();
+	}
+}
+
+bool dae::Renderer::SetRenderMode(RenderMode mode)
+{
+	if (mode == RenderMode::VisibilityBuffer && !m_VisibilityBufferSupported)
+		return false;
+
+	m_RenderMode = mode;
+	return true;
+}
+
+void dae::Renderer::SwitchRenderMode()
+{
+	switch (m_RenderMode)
+	{
+	case RenderMode::Forward:
+		m_RenderMode = RenderMode::Deferred;
+		std::cout << "Render mode: Deferred" << std::endl;
+		break;
+	case RenderMode::Deferred:
+		if (!m_VisibilityBufferSupported)
+		{
+			m_RenderMode = RenderMode::DepthPrePass;
+			std::cout << "Render mode: Depth pre-pass (visibility buffer skipped, its ids can't address this scene, over "
+				<< MaxTriangleIdMeshes << " meshes or " << TriangleIdIndexMask << " indices in a mesh)" << std::endl;
+			break;
+		}
+		m_RenderMode = RenderMode::VisibilityBuffer;
+		std::cout << "Render mode: Visibility buffer" << std::endl;
+		break;
+	case RenderMode::VisibilityBuffer:
+		m_RenderMode = RenderMode::DepthPrePass;
+		std::cout << "Render mode: Depth pre-pass" << std::endl;
+		break;
+	case RenderMode::DepthPrePass:
+		m_RenderMode = RenderMode::Forward;
+		std::cout << "Render mode: Forward" << std::endl;
+		break;
+	}
+}
+
+bool Renderer::SaveBufferToImage(const char* pPath) const
 {
-	return SDL_SaveBMP(m_pBackBuffer, "Rasterizer_ColorBuffer.bmp");
+	if (m_pBackBuffer)
+		return SDL_SaveBMP(m_pBackBuffer, pPath);
+
+	// headless: wrap the framebuffer in a surface just for saving
+	SDL_Surface* pSurface{ SDL_CreateRGBSurfaceFrom(m_pBackBufferPixels, m_Width, m_Height, 32, m_Width * static_cast<int>(sizeof(uint32_t)),
+		0xFFu << m_PixelPacker.rShift, 0xFFu << m_PixelPacker.gShift, 0xFFu << m_PixelPacker.bShift, m_PixelPacker.alphaMask) };
+	if (!pSurface)
+		return true;
+
+	const bool result{ SDL_SaveBMP(pSurface, pPath) != 0 };
+	SDL_FreeSurface(pSurface);
+	return result;
 }
@@ -1,10 +1,18 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <utility>
 #include <vector>
 
 #include "Camera.h"
 #include "DataTypes.h"
+#include "DepthBuffer.h"
+#include "FrameArena.h"
+#include "PixelPacker.h"
+#include "RenderQueue.h"
+#include "Scene.h"
+#include "Varyings.h"
 
 struct SDL_Window;
 struct SDL_Surface;
@@ -16,12 +24,16 @@ namespace dae
 	struct Vertex;
 	class Timer;
 	class Scene;
+	class GBuffer;
+	class OcclusionBuffer;
 
 	class Renderer final
 	{
 	public:
 
-		Renderer(SDL_Window* pWindow);
+		Renderer(SDL_Window* pWindow, SceneType scene = SceneType::Quad);
+		// Headless: renders into a plain memory framebuffer, no window and no SDL video needed
+		Renderer(int width, int height, SceneType scene = SceneType::Quad);
 		~Renderer();
 
 		Renderer(const Renderer&) = delete;
@@ -32,17 +44,102 @@ namespace dae
 		void Update(Timer* pTimer);
 		void Render();
 
-		bool SaveBufferToImage() const;
+		bool SaveBufferToImage(const char* pPath = "Rasterizer_ColorBuffer.bmp") const;
 		void SwitchVisualizationMethod();
+		void SwitchDepthFormat();
+		void SwitchRenderMode();
+		void SwitchRasterKernels();
+		void SwitchVertexFormat();
+		void SwitchClusterCulling();
+		void SwitchOcclusionCulling();
+		void SwitchHierarchicalZ();
+		void SwitchDrawSorting();
+
+		enum class RenderMode
+		{
+			Forward,
+			Deferred,
+			VisibilityBuffer,
+			// depth only pass first, then a color pass with an equal depth test
+			// wins with heavy overdraw and expensive shading, loses on sorted or low overdraw scenes
+			// since every triangle gets set up and rasterized twice
+			DepthPrePass
+		};
+
+		// What the Switch functions do without the console message, for the benchmarks that write JSON to stdout
+		// and the regression test. SetRenderMode returns false and keeps the current mode when the visibility
+		// buffer can't address the scene
+		bool SetRenderMode(RenderMode mode);
+		void SetDepthFormat(DepthFormat format);
+		void SetQuantizedVertices(bool useQuantized);
+		void SetSpecializedKernels(bool useSpecialized) { m_UseSpecializedKernels = useSpecialized; }
+		void SetOcclusionCulling(bool useOcclusionCulling) { m_UseOcclusionCulling = useOcclusionCulling; }
+		void SetHierarchicalZ(bool useHierarchicalZ) { m_UseHierarchicalZ = useHierarchicalZ; }
+
+		struct FrameStats
+		{
+			// pixels that went through texture sampling/shading
+			uint32_t shadedPixels{};
+			// transient memory the frame took from the frame arena, and the most any frame needed so far
+			size_t frameArenaBytes{};
+			size_t frameArenaHighWaterMark{};
+			// triangles that made it past cluster culling to RenderTrianglesMesh
+			uint32_t submittedTriangles{};
+			uint32_t culledClusters{};
+			// culled against the occluders, and the time it took to render them and build the pyramid
+			uint32_t occludedMeshes{};
+			uint32_t occludedClusters{};
+			float occlusionPassMs{};
+			// 8x8 blocks of triangles rejected against the farthest depth of their depth buffer tile
+			uint32_t rejectedBlocks{};
+			// the depth pre-pass and the color draws, without the vertex stage and deferred shading
+			float rasterMs{};
+		};
+
+		FrameStats GetFrameStats() const { return m_FrameStats; }
+		// pixels that ended up with geometry in the final image, scans the whole depth buffer so only ask for it when it gets printed
+		uint32_t CountCoveredPixels() const;
+
+		// false when the scene's model couldn't be loaded, every frame would just be the clear color
+		bool HasGeometry() const { return !m_Meshes.empty(); }
+		int GetWidth() const { return m_Width; }
+		int GetHeight() const { return m_Height; }
+		// XRGB pixels of the last rendered frame, packed with the back buffer's format
+		const uint32_t* GetBackBufferPixels() const { return m_pBackBufferPixels; }
+		// layout of the back buffer pixels
+		const PixelPacker& GetPixelPacker() const { return m_PixelPacker; }
+		Camera& GetCamera() { return m_Camera; }
 
 	private:
+		// nullptr when headless, Render then skips presenting
 		SDL_Window* m_pWindow{};
 
 		SDL_Surface* m_pFrontBuffer{ nullptr };
 		SDL_Surface* m_pBackBuffer{ nullptr };
 		uint32_t* m_pBackBufferPixels{};
-
-		float* m_pDepthBufferPixels{};
+		PixelPacker m_PixelPacker{};
+
+		// per-tile fast clear state of the back buffer
+		uint32_t m_ClearColor{};
+		uint8_t* m_pColorTileCleared{ nullptr };
+		int m_TilesX{};
+		int m_TilesY{};
+
+		DepthBuffer* m_pDepthBuffer{ nullptr };
+		GBuffer* m_pGBuffer{ nullptr };
+
+		// every per-frame render allocation comes from here, reset once the frame is presented
+		static constexpr size_t FrameArenaCapacity{ 1 << 20 };
+		FrameArena* m_pFrameArena{ nullptr };
+
+		// visibility buffer: (mesh index << TriangleIdIndexBits) | (first index of the triangle + 1), 0 is empty
+		uint32_t* m_pTriangleIds{ nullptr };
+		static constexpr uint32_t TriangleIdIndexBits{ 24 };
+		static constexpr uint32_t TriangleIdIndexMask{ (1u << TriangleIdIndexBits) - 1 };
+		static constexpr size_t MaxTriangleIdMeshes{ size_t{ 1 } << (32 - TriangleIdIndexBits) };
+		// false when the scene has more meshes or indices than the ids can address, switching render modes skips the visibility buffer then
+		bool m_VisibilityBufferSupported{ true };
+		std::vector<int> m_TileRows{};
 
 		Camera m_Camera{};
 
@@ -59,17 +156,94 @@ namespace dae
 
 		VisualizationMethod m_VisualizationMethod{ VisualizationMethod::FinalColor };
 
+		RenderMode m_RenderMode{ RenderMode::Forward };
+
+		// What the vertex stage packs and the rasterizer interpolates for a pipeline,
+		// the visibility buffer and the depth visualization don't need any varyings
+		static constexpr VaryingLayout GetVaryingLayout(RenderMode mode, VisualizationMethod visualization)
+		{
+			// deferred fills the gbuffer uvs in every visualization
+			if (mode == RenderMode::Deferred)
+				return VaryingLayout{ Varying::UV };
+			if (mode == RenderMode::VisibilityBuffer || visualization == VisualizationMethod::DepthBuffer)
+				return VaryingLayout{};
+			return VaryingLayout{ Varying::UV };
+		}
+
+		std::vector<Mesh> m_Meshes{};
+		// the vertex stage reads 16-bit positions, octahedral normals and half uvs instead of float vertices
+		bool m_UseQuantizedVertices{ false };
+		// frustum and normal cone culling per cluster, off still goes through the clusters
+		bool m_UseClusterCulling{ true };
+
+		// occluders at a quarter of the resolution, meshes and clusters get tested against its depth pyramid
+		static constexpr int OcclusionDownscale{ 4 };
+		OcclusionBuffer* m_pOcclusionBuffer{ nullptr };
+		bool m_UseOcclusionCulling{ true };
+		bool m_HasOccluders{ false };
+
+		// per tile early rejection in the raster kernels, see DepthBuffer::IsTileHidden
+		bool m_UseHierarchicalZ{ true };
+
+		// opaque draws front to back so the depth tests reject as early as possible, off keeps the scene order
+		bool m_SortDraws{ true };
+
+		// specialized kernels per pipeline state, or one generic kernel that branches at runtime (for comparing)
+		bool m_UseSpecializedKernels{ true };
+
+		static constexpr size_t NrVisualizationMethods{ 2 };
+		static constexpr size_t NrRenderModes{ 4 };
+		static constexpr size_t NrDepthFormats{ 4 };
+		static constexpr size_t NrTopologies{ 2 };
+
+		using DrawFunction = void (Renderer::*)(const Mesh& mesh, uint32_t meshIdx);
+
+		template<size_t... Indices>
+		static constexpr std::array<DrawFunction, sizeof...(Indices)> MakeDrawTable(std::index_sequence<Indices...>);
+		template<size_t... Indices>
+		static constexpr std::array<DrawFunction, sizeof...(Indices)> MakeDepthOnlyTable(std::index_sequence<Indices...>);
+
+		template<bool Specialized, VisualizationMethod Visualization, RenderMode Mode, DepthFormat Format, PrimitiveTopology Topology>
+		void RenderMeshKernel(const Mesh& mesh, uint32_t meshIdx);
+		template<DepthFormat Format, PrimitiveTopology Topology>
+		void RenderMeshDepthOnlyKernel(const Mesh& mesh, uint32_t meshIdx);
+		FrameStats m_FrameStats{};
+
+		void WritePixel(int px, int py, uint32_t color);
+		void TouchColorTile(int px, int py);
+		void FlushPixelBatch(const ColorRGB* pColors, const int* pPixelIndices, int count);
+		void FillTile(uint32_t* pBuffer, int tileIdx, uint32_t value);
+		void ResolveBackBuffer();
+
+		void ShadeDeferred(const std::vector<Mesh>& meshes);
+		uint32_t ShadeDeferredTileRow(int tileY, const std::vector<Mesh>& meshes);
+		ColorRGB ShadeGBufferPixel(int px, int py) const;
+		static bool FitsTriangleIds(const std::vector<Mesh>& meshes);
+		ColorRGB ShadeVisibilityPixel(int px, int py, const std::vector<Mesh>& meshes, uint32_t triangleId) const;
+
 		void VertexTransformationFunction(const std::vector<Vertex>& vertices_in, std::vector<Vertex>& vertices_out) const;
 		void VertexTransformationFunction(std::vector<Mesh>& meshes) const;
+		void UpdateWorldViewProjections(std::vector<Mesh>& meshes) const;
+		void CullClusters(std::vector<Mesh>& meshes);
+		void RenderOcclusionPass(const std::vector<Mesh>& meshes);
+		std::span<const DrawItem> BuildRenderQueue(const std::vector<Mesh>& meshes);
+		bool IsOccluded(const Matrix& wvProjectionMatrix, const Vector3& center, float radius) const;
 		void RenderTrianglesMesh(const Mesh& mesh, const std::vector<Vector2>& screenVertices, const std::vector<Vertex> ndcVertices, size_t vertIdx, bool swapVerts = false);
-		void RenderTrianglesMesh(const Mesh& mesh, const std::vector<Vertex_Out>& verts_out, const std::vector<Vertex> verts, size_t vertIdx, bool swapVerts = false);
+		void RenderMesh(const Mesh& mesh, uint32_t meshIdx, bool depthOnly);
+		template<DepthFormat Format>
+		void RenderTriangleDepthOnly(const Mesh& mesh, size_t vertIdx, bool swapVerts);
+		template<bool Specialized, VisualizationMethod Visualization, RenderMode Mode, DepthFormat Format>
+		void RenderTrianglesMesh(const Mesh& mesh, size_t vertIdx, bool swapVerts, uint32_t meshIdx);
 		
-		Vertex_Out ConvertFromNDCtoScreen(const Vertex_Out& vert_out);
+		Vertex_Out ConvertFromNDCtoScreen(const Vertex_Out& vert_out) const;
 		Vertex ConvertFromDNCtoScreen(const Vertex& vert);
 
 		bool CheckIfIsInFrustrum(const Vertex_Out& vert);
 
 		void RenderW6();
+		// shared by both constructors once the size and back buffer are known
+		void Initialize(SceneType scene);
+
 		void RenderW7();
 	};
 }
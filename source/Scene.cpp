@@ -0,0 +1,138 @@
+#include "Scene.h"
+#include "Utils.h"
+
+#include <iostream>
+#include <utility>
+
+namespace dae
+{
+	namespace
+	{
+		// The 3x3 vertex grid the renderer started out with, 6x6 units facing -z
+		Mesh CreateQuadStrip()
+		{
+			return Mesh{
+				{
+					// Verts (not vert outs, those are still empty)
+					Vertex{{-3, 3, -2}, colors::White, Vector2{0,0}},
+					Vertex{{0, 3, -2}, colors::White, Vector2{.5f,0}},
+					Vertex{{3, 3, -2}, colors::White, Vector2{1.f,0}},
+					Vertex{{-3, 0, -2}, colors::White, Vector2{0,.5f}},
+					Vertex{{0, 0, -2}, colors::White, Vector2{.5f,.5f}},
+					Vertex{{3, 0, -2}, colors::White, Vector2{1.f,.5f}},
+					Vertex{{-3, -3, -2}, colors::White, Vector2{0,1.f}},
+					Vertex{{0, -3, -2}, colors::White, Vector2{.5f,1.f}},
+					Vertex{{3, -3, -2}, colors::White, Vector2{1.f,1.f}}
+				},
+				{
+					// Indices
+					3,0,4,1,5,2,
+					2,6,
+					6,3,7,4,8,5
+				},
+				// Primitive topology
+				PrimitiveTopology::TriangleStrip
+			};
+		}
+
+		std::vector<Mesh> LoadModel(const std::string& path, const Vector3& position)
+		{
+			Mesh mesh{};
+			mesh.primitiveTopology = PrimitiveTopology::TriangleList;
+
+			if (!Utils::ParseOBJ(path, mesh.vertices, mesh.indices))
+			{
+				std::cerr << "Couldn't load " << path << std::endl;
+				return {};
+			}
+
+			mesh.worldMatrix = Matrix::CreateTranslation(position);
+			return { std::move(mesh) };
+		}
+	}
+
+	std::vector<Mesh> CreateScene(SceneType scene)
+	{
+		switch (scene)
+		{
+		case SceneType::Quad:
+			return { CreateQuadStrip() };
+		case SceneType::QuadField:
+		{
+			constexpr int nrLayers{ 8 };
+			constexpr float layerSpacing{ 5.f };
+			constexpr float quadSpacing{ 7.f };
+
+			std::vector<Mesh> meshes{};
+			meshes.reserve(nrLayers * 9);
+
+			for (int layer{}; layer < nrLayers; ++layer)
+			{
+				// every other layer is shifted half a quad so the layers behind stay partly visible
+				const float shift{ (layer % 2) * quadSpacing * 0.5f };
+
+				for (int row{ -1 }; row <= 1; ++row)
+				{
+					for (int column{ -1 }; column <= 1; ++column)
+					{
+						Mesh quad{ CreateQuadStrip() };
+						quad.worldMatrix = Matrix::CreateTranslation(column * quadSpacing + shift, 5.f + row * quadSpacing, layer * layerSpacing);
+						quad.isOccluder = layer == 0 && row == 0 && column == 0;
+						meshes.push_back(std::move(quad));
+					}
+				}
+			}
+
+			return meshes;
+		}
+		// the default camera sits at (0, 5, -30) looking down +z
+		case SceneType::Vehicle:
+			return LoadModel("Resources/vehicle.obj", Vector3{ 0.f, 5.f, 15.f });
+		case SceneType::TukTuk:
+			return LoadModel("Resources/tuktuk.obj", Vector3{ 0.f, -1.f, 0.f });
+		}
+		return {};
+	}
+
+	const char* GetSceneTexturePath(SceneType scene)
+	{
+		switch (scene)
+		{
+		case SceneType::Vehicle:
+			return "Resources/vehicle_diffuse.png";
+		case SceneType::TukTuk:
+			return "Resources/tuktuk.png";
+		default:
+			return "Resources/uv_grid_2.png";
+		}
+	}
+
+	const char* GetSceneName(SceneType scene)
+	{
+		switch (scene)
+		{
+		case SceneType::Quad:
+			return "quad";
+		case SceneType::QuadField:
+			return "quadfield";
+		case SceneType::Vehicle:
+			return "vehicle";
+		case SceneType::TukTuk:
+			return "tuktuk";
+		}
+		return "unknown";
+	}
+
+	bool TryParseSceneType(const std::string& name, SceneType& scene)
+	{
+		for (const SceneType candidate : { SceneType::Quad, SceneType::QuadField, SceneType::Vehicle, SceneType::TukTuk })
+		{
+			if (name == GetSceneName(candidate))
+			{
+				scene = candidate;
+				return true;
+			}
+		}
+		return false;
+	}
+}
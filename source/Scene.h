@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	enum class SceneType
+	{
+		// the textured quad strip
+		Quad,
+		// layers of quads receding from the camera that overlap each other, the front center one is an occluder
+		QuadField,
+		// the OBJ models in Resources, placed in front of the default camera
+		Vehicle,
+		TukTuk
+	};
+
+	// Meshes of the scene with their world matrices, clusters still have to be built.
+	// Empty when a model can't be loaded
+	std::vector<Mesh> CreateScene(SceneType scene);
+
+	// Diffuse texture the scene gets rendered with
+	const char* GetSceneTexturePath(SceneType scene);
+
+	const char* GetSceneName(SceneType scene);
+	bool TryParseSceneType(const std::string& name, SceneType& scene);
+}
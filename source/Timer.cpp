@@ -53,6 +53,8 @@ void Timer::Update()
 	if (m_ElapsedTime < 0.0f)
 		m_ElapsedTime = 0.0f;
 
+	m_FrameTimeStats.AddFrame(m_ElapsedTime);
+
 	if (m_ForceElapsedUpperBound && m_ElapsedTime > m_ElapsedUpperBound)
 	{
 		m_ElapsedTime = m_ElapsedUpperBound;
@@ -3,6 +3,9 @@
 //Standard includes
 #include <cstdint>
 
+//Project includes
+#include "FrameTimeStats.h"
+
 namespace dae
 {
 	class Timer
@@ -26,6 +29,8 @@ namespace dae
 		float GetElapsed() const { return m_ElapsedTime; };
 		float GetTotal() const { return m_TotalTime; };
 		bool IsRunning() const { return !m_IsStopped; };
+		// every frame time Update measured, before the upper bound gets applied
+		const FrameTimeStats& GetFrameTimeStats() const { return m_FrameTimeStats; };
 
 	private:
 		uint64_t m_BaseTime = 0;
@@ -46,5 +51,7 @@ namespace dae
 
 		bool m_IsStopped = true;
 		bool m_ForceElapsedUpperBound = false;
+
+		FrameTimeStats m_FrameTimeStats{};
 	};
 }
\ No newline at end of file
@@ -4,8 +4,6 @@
 #include "Math.h"
 #include "DataTypes.h"
 
-#define DISABLE_OBJ
-
 namespace dae
 {
 	namespace Utils
@@ -0,0 +1,37 @@
+#include "Varyings.h"
+
+#include <xmmintrin.h>
+
+namespace dae
+{
+	void InterpolateVaryings(const PlaneEquation* pPlanes, int nrFloats, const PlaneEquation& invWPlane,
+		const float* pX, const float* pY, float* pOut)
+	{
+		static_assert(VaryingBatchSize % 4 == 0, "fragments are interpolated 4 at a time");
+
+		for (int fragmentIdx{}; fragmentIdx < VaryingBatchSize; fragmentIdx += 4)
+		{
+			const __m128 x{ _mm_loadu_ps(pX + fragmentIdx) };
+			const __m128 y{ _mm_loadu_ps(pY + fragmentIdx) };
+
+			// w = 1 / (1/w), one division for 4 fragments that every varying reuses
+			const __m128 invW{ _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(_mm_set1_ps(invWPlane.dx), x),
+				_mm_mul_ps(_mm_set1_ps(invWPlane.dy), y)),
+				_mm_set1_ps(invWPlane.offset)) };
+			const __m128 w{ _mm_div_ps(_mm_set1_ps(1.f), invW) };
+
+			for (int floatIdx{}; floatIdx < nrFloats; ++floatIdx)
+			{
+				const PlaneEquation& plane{ pPlanes[floatIdx] };
+
+				const __m128 value{ _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(_mm_set1_ps(plane.dx), x),
+					_mm_mul_ps(_mm_set1_ps(plane.dy), y)),
+					_mm_set1_ps(plane.offset)) };
+
+				_mm_storeu_ps(pOut + floatIdx * VaryingBatchSize + fragmentIdx, _mm_mul_ps(value, w));
+			}
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <initializer_list>
+
+#include "DataTypes.h"
+#include "PlaneEquation.h"
+#include "VertexQuantization.h"
+
+namespace dae
+{
+	enum class Varying
+	{
+		Color,
+		UV,
+		Normal,
+		Tangent,
+		ViewDirection
+	};
+
+	// Which attributes a pipeline interpolates, packed contiguously per vertex
+	// (e.g. only u, v for a textured forward pass instead of the whole Vertex)
+	struct VaryingLayout
+	{
+		static constexpr int NrVaryings{ 5 };
+		static constexpr int MaxFloats{ 14 };
+
+		int nrFloats{};
+		// float offset of every varying in the packed vertex, -1 when it isn't part of the layout
+		int offsets[NrVaryings]{ -1, -1, -1, -1, -1 };
+
+		constexpr VaryingLayout() = default;
+		constexpr VaryingLayout(std::initializer_list<Varying> varyings)
+		{
+			for (const Varying varying : varyings)
+			{
+				offsets[static_cast<int>(varying)] = nrFloats;
+				nrFloats += GetSize(varying);
+			}
+		}
+
+		constexpr bool Has(Varying varying) const { return offsets[static_cast<int>(varying)] >= 0; }
+		constexpr int GetOffset(Varying varying) const { return offsets[static_cast<int>(varying)]; }
+
+		static constexpr int GetSize(Varying varying)
+		{
+			return varying == Varying::UV ? 2 : 3;
+		}
+
+		// Writes the varyings of this layout already divided by w, ready for the plane setup
+		void Pack(const Vertex& vertex, float invW, float* pOut) const
+		{
+			if (Has(Varying::Color))
+				PackFloats(&vertex.color.r, 3, invW, pOut + GetOffset(Varying::Color));
+			if (Has(Varying::UV))
+				PackFloats(&vertex.uv.x, 2, invW, pOut + GetOffset(Varying::UV));
+			if (Has(Varying::Normal))
+				PackFloats(&vertex.normal.x, 3, invW, pOut + GetOffset(Varying::Normal));
+			if (Has(Varying::Tangent))
+				PackFloats(&vertex.tangent.x, 3, invW, pOut + GetOffset(Varying::Tangent));
+			if (Has(Varying::ViewDirection))
+				PackFloats(&vertex.viewDirection.x, 3, invW, pOut + GetOffset(Varying::ViewDirection));
+		}
+
+		// Same for a quantized vertex, only the varyings in the layout get decoded
+		void Pack(const QuantizedVertex& vertex, float invW, float* pOut) const
+		{
+			if (Has(Varying::Color))
+			{
+				float* pColor{ pOut + GetOffset(Varying::Color) };
+				for (int i{}; i < 3; ++i)
+				{
+					pColor[i] = static_cast<float>(vertex.color[i]) * (invW / 255.f);
+				}
+			}
+			if (Has(Varying::UV))
+			{
+				const Vector2 uv{ DecodeUV(vertex) };
+				PackFloats(&uv.x, 2, invW, pOut + GetOffset(Varying::UV));
+			}
+			if (Has(Varying::Normal))
+			{
+				const Vector3 normal{ DecodeOctahedral(vertex.normal) };
+				PackFloats(&normal.x, 3, invW, pOut + GetOffset(Varying::Normal));
+			}
+			if (Has(Varying::Tangent))
+			{
+				const Vector3 tangent{ DecodeOctahedral(vertex.tangent) };
+				PackFloats(&tangent.x, 3, invW, pOut + GetOffset(Varying::Tangent));
+			}
+			// view direction depends on the camera, there's nothing stored to decode
+			if (Has(Varying::ViewDirection))
+				PackFloats(&Vector3::Zero.x, 3, invW, pOut + GetOffset(Varying::ViewDirection));
+		}
+
+	private:
+		static void PackFloats(const float* pValues, int nrValues, float invW, float* pOut)
+		{
+			for (int i{}; i < nrValues; ++i)
+			{
+				pOut[i] = pValues[i] * invW;
+			}
+		}
+	};
+
+	static constexpr int VaryingBatchSize{ 8 };
+
+	// Perspective correct interpolation of nrFloats planes for VaryingBatchSize fragments at once (SSE),
+	// pOut is laid out per float: pOut[floatIdx * VaryingBatchSize + fragmentIdx]
+	void InterpolateVaryings(const PlaneEquation* pPlanes, int nrFloats, const PlaneEquation& invWPlane,
+		const float* pX, const float* pY, float* pOut);
+}
@@ -1,8 +1,11 @@
 #pragma once
+#include <cassert>
+#include <cmath>
+
+#include "Vector2.h"
 
 namespace dae
 {
-	struct Vector2;
 	struct Vector3;
 	struct Vector4
 	{
@@ -12,25 +15,124 @@ namespace dae
 		float w;
 
 		Vector4() = default;
-		Vector4(float _x, float _y, float _z, float _w);
-		Vector4(const Vector3& v, float _w);
+		constexpr Vector4(float _x, float _y, float _z, float _w);
+		constexpr Vector4(const Vector3& v, float _w);
 
 		float Magnitude() const;
-		float SqrMagnitude() const;
+		constexpr float SqrMagnitude() const;
 		float Normalize();
 		Vector4 Normalized() const;
 
-		Vector2 GetXY() const;
-		Vector3 GetXYZ() const;
+		constexpr Vector2 GetXY() const;
+		constexpr Vector3 GetXYZ() const;
 
-		static float Dot(const Vector4& v1, const Vector4& v2);
+		static constexpr float Dot(const Vector4& v1, const Vector4& v2);
 
 		// operator overloading
-		Vector4 operator*(float scale) const;
-		Vector4 operator+(const Vector4& v) const;
-		Vector4 operator-(const Vector4& v) const;
-		Vector4& operator+=(const Vector4& v);
-		float& operator[](int index);
-		float operator[](int index) const;
+		constexpr Vector4 operator*(float scale) const;
+		constexpr Vector4 operator+(const Vector4& v) const;
+		constexpr Vector4 operator-(const Vector4& v) const;
+		constexpr Vector4& operator+=(const Vector4& v);
+		constexpr float& operator[](int index);
+		constexpr float operator[](int index) const;
 	};
+
+	// Everything is defined in the header so the raster loops can inline it without link time code generation
+	constexpr Vector4::Vector4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+
+	inline float Vector4::Magnitude() const
+	{
+		return sqrtf(x * x + y * y + z * z + w * w);
+	}
+
+	constexpr float Vector4::SqrMagnitude() const
+	{
+		return x * x + y * y + z * z + w * w;
+	}
+
+	inline float Vector4::Normalize()
+	{
+		const float m = Magnitude();
+		x /= m;
+		y /= m;
+		z /= m;
+		w /= m;
+
+		return m;
+	}
+
+	inline Vector4 Vector4::Normalized() const
+	{
+		const float m = Magnitude();
+		return { x / m, y / m, z / m, w / m };
+	}
+
+	constexpr Vector2 Vector4::GetXY() const
+	{
+		return { x, y };
+	}
+
+	constexpr float Vector4::Dot(const Vector4& v1, const Vector4& v2)
+	{
+		return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z + v1.w * v2.w;
+	}
+
+#pragma region Operator Overloads
+	constexpr Vector4 Vector4::operator*(float scale) const
+	{
+		return { x * scale, y * scale, z * scale, w * scale };
+	}
+
+	constexpr Vector4 Vector4::operator+(const Vector4& v) const
+	{
+		return { x + v.x, y + v.y, z + v.z, w + v.w };
+	}
+
+	constexpr Vector4 Vector4::operator-(const Vector4& v) const
+	{
+		return { x - v.x, y - v.y, z - v.z, w - v.w };
+	}
+
+	constexpr Vector4& Vector4::operator+=(const Vector4& v)
+	{
+		x += v.x;
+		y += v.y;
+		z += v.z;
+		w += v.w;
+		return *this;
+	}
+
+	constexpr float& Vector4::operator[](int index)
+	{
+		assert(index <= 3 && index >= 0);
+
+		if (index == 0)return x;
+		if (index == 1)return y;
+		if (index == 2)return z;
+		return w;
+	}
+
+	constexpr float Vector4::operator[](int index) const
+	{
+		assert(index <= 3 && index >= 0);
+
+		if (index == 0)return x;
+		if (index == 1)return y;
+		if (index == 2)return z;
+		return w;
+	}
+#pragma endregion
+}
+
+// see the end of Vector3.h
+#include "Vector3.h"
+
+namespace dae
+{
+	constexpr Vector4::Vector4(const Vector3& v, float _w) : x(v.x), y(v.y), z(v.z), w(_w) {}
+
+	constexpr Vector3 Vector4::GetXYZ() const
+	{
+		return { x,y,z };
+	}
 }
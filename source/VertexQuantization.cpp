@@ -0,0 +1,110 @@
+#include "VertexQuantization.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace dae
+{
+	void QuantizeMesh(Mesh& mesh)
+	{
+		mesh.quantizedVertices.clear();
+		if (mesh.vertices.empty())
+			return;
+
+		Vector3 min{ mesh.vertices[0].position };
+		Vector3 max{ mesh.vertices[0].position };
+		for (const Vertex& vertex : mesh.vertices)
+		{
+			min = Vector3{ std::min(min.x, vertex.position.x), std::min(min.y, vertex.position.y), std::min(min.z, vertex.position.z) };
+			max = Vector3{ std::max(max.x, vertex.position.x), std::max(max.y, vertex.position.y), std::max(max.z, vertex.position.z) };
+		}
+
+		constexpr float MaxValue{ 65535.f };
+		const Vector3 extent{ max - min };
+		mesh.quantizationMin = min;
+		mesh.quantizationScale = extent / MaxValue;
+
+		mesh.quantizedVertices.reserve(mesh.vertices.size());
+		for (const Vertex& vertex : mesh.vertices)
+		{
+			QuantizedVertex quantized{};
+
+			for (int axis{}; axis < 3; ++axis)
+			{
+				// a flat axis (e.g. a quad in a plane) has no extent, everything sits at min
+				const float normalized{ extent[axis] > 0.f ? (vertex.position[axis] - min[axis]) / extent[axis] : 0.f };
+				quantized.position[axis] = static_cast<uint16_t>(Saturate(normalized) * MaxValue + 0.5f);
+			}
+
+			quantized.uv[0] = FloatToHalf(vertex.uv.x);
+			quantized.uv[1] = FloatToHalf(vertex.uv.y);
+			EncodeOctahedral(vertex.normal, quantized.normal);
+			EncodeOctahedral(vertex.tangent, quantized.tangent);
+
+			quantized.color[0] = static_cast<uint8_t>(Saturate(vertex.color.r) * 255.f + 0.5f);
+			quantized.color[1] = static_cast<uint8_t>(Saturate(vertex.color.g) * 255.f + 0.5f);
+			quantized.color[2] = static_cast<uint8_t>(Saturate(vertex.color.b) * 255.f + 0.5f);
+
+			mesh.quantizedVertices.push_back(quantized);
+		}
+	}
+
+	size_t GetVertexMemory(const Mesh& mesh)
+	{
+		if (!mesh.quantizedVertices.empty())
+			return mesh.quantizedVertices.size() * sizeof(QuantizedVertex);
+
+		return mesh.vertices.size() * sizeof(Vertex);
+	}
+
+	uint16_t FloatToHalf(float value)
+	{
+		uint32_t bits{};
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		const uint32_t sign{ (bits >> 16) & 0x8000u };
+		uint32_t absBits{ bits & 0x7FFFFFFFu };
+
+		// too big for a half (or inf/nan)
+		if (absBits >= 0x477FF000u)
+			return static_cast<uint16_t>(sign | (absBits > 0x7F800000u ? 0x7E00u : 0x7C00u));
+
+		// subnormal half, let the float adder do the round to nearest even
+		if (absBits < 0x38800000u)
+		{
+			float absValue{};
+			std::memcpy(&absValue, &absBits, sizeof(absValue));
+			absValue += 0.5f;
+
+			uint32_t roundedBits{};
+			std::memcpy(&roundedBits, &absValue, sizeof(roundedBits));
+			return static_cast<uint16_t>(sign | (roundedBits - 0x3F000000u));
+		}
+
+		// rebias the exponent and round the 13 dropped mantissa bits to nearest even
+		const uint32_t mantissaOdd{ (absBits >> 13) & 1u };
+		absBits += ((15u - 127u) << 23) + 0xFFFu + mantissaOdd;
+		return static_cast<uint16_t>(sign | (absBits >> 13));
+	}
+
+	void EncodeOctahedral(const Vector3& direction, uint16_t* pEncoded)
+	{
+		const float length{ std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z) };
+
+		// zero vectors (unset normals/tangents) decode as +z
+		float x{ length > 0.f ? direction.x / length : 0.f };
+		float y{ length > 0.f ? direction.y / length : 0.f };
+
+		// fold the lower hemisphere over the diagonals
+		if (length > 0.f && direction.z < 0.f)
+		{
+			const float foldedX{ (1.f - std::abs(y)) * (x >= 0.f ? 1.f : -1.f) };
+			const float foldedY{ (1.f - std::abs(x)) * (y >= 0.f ? 1.f : -1.f) };
+			x = foldedX;
+			y = foldedY;
+		}
+
+		pEncoded[0] = static_cast<uint16_t>(static_cast<int16_t>(std::round(std::clamp(x, -1.f, 1.f) * 32767.f)));
+		pEncoded[1] = static_cast<uint16_t>(static_cast<int16_t>(std::round(std::clamp(y, -1.f, 1.f) * 32767.f)));
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	// Fills mesh.quantizedVertices from mesh.vertices, positions get normalized against the mesh AABB
+	void QuantizeMesh(Mesh& mesh);
+	// Bytes of vertex data the vertex stage reads for this mesh
+	size_t GetVertexMemory(const Mesh& mesh);
+
+	uint16_t FloatToHalf(float value);
+	void EncodeOctahedral(const Vector3& direction, uint16_t* pEncoded);
+
+	inline float HalfToFloat(uint16_t half)
+	{
+		// Shift exponent and mantissa into place and rebias with a multiply by 2^112,
+		// which also turns half subnormals into the right float without a branch
+		uint32_t bits{ static_cast<uint32_t>(half & 0x7FFF) << 13 };
+		const uint32_t rebias{ 0x77800000u };
+
+		float value{};
+		float scale{};
+		std::memcpy(&value, &bits, sizeof(value));
+		std::memcpy(&scale, &rebias, sizeof(scale));
+		value *= scale;
+
+		std::memcpy(&bits, &value, sizeof(bits));
+		// inf/nan keep their all-ones exponent
+		if ((half & 0x7C00) == 0x7C00)
+			bits |= 0x7F800000u;
+		bits |= static_cast<uint32_t>(half & 0x8000) << 16;
+
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	inline Vector3 DecodeOctahedral(const uint16_t* pEncoded)
+	{
+		float x{ static_cast<float>(static_cast<int16_t>(pEncoded[0])) / 32767.f };
+		float y{ static_cast<float>(static_cast<int16_t>(pEncoded[1])) / 32767.f };
+		const float z{ 1.f - std::abs(x) - std::abs(y) };
+
+		// lower hemisphere got folded over the diagonals
+		const float fold{ std::max(-z, 0.f) };
+		x += x >= 0.f ? -fold : fold;
+		y += y >= 0.f ? -fold : fold;
+
+		return Vector3{ x, y, z }.Normalized();
+	}
+
+	inline Vector3 DecodePosition(const QuantizedVertex& vertex, const Vector3& min, const Vector3& scale)
+	{
+		return Vector3{
+			min.x + static_cast<float>(vertex.position[0]) * scale.x,
+			min.y + static_cast<float>(vertex.position[1]) * scale.y,
+			min.z + static_cast<float>(vertex.position[2]) * scale.z
+		};
+	}
+
+	inline Vector2 DecodeUV(const QuantizedVertex& vertex)
+	{
+		return Vector2{ HalfToFloat(vertex.uv[0]), HalfToFloat(vertex.uv[1]) };
+	}
+}
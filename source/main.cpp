@@ -5,14 +5,281 @@
 #undef main
 
 //Standard includes
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <string>
 
 //Project includes
 #include "Timer.h"
 #include "Renderer.h"
+#include "CameraPath.h"
+#include "PerfCounters.h"
+#include "Profiler.h"
+#include "RegressionTest.h"
+#include "Scene.h"
 
 using namespace dae;
 
+struct CommandLineOptions
+{
+	bool isHeadless{ false };
+	int width{ 640 };
+	int height{ 480 };
+	SceneType scene{ SceneType::Quad };
+
+	// headless only, and the length of the orbit
+	int nrFrames{ 100 };
+	// "static", "orbit" or a camera path file (see CameraPath::LoadFromFile).
+	// With a window anything but "static" replays the path instead of taking input and quits at its end
+	std::string cameraPath{ "static" };
+	// every frame's camera pose of a windowed session gets saved here at exit
+	std::string recordPath{};
+	// the last frame gets saved here when it's not empty
+	std::string outputPath{};
+
+	// Chrome trace of the profiling markers, written at exit (needs ENABLE_PROFILING)
+	std::string tracePath{};
+	// frame time summary and histogram, written at exit
+	std::string frameTimesPath{};
+	// hardware counters per profiling marker (needs ENABLE_PROFILING, Linux)
+	bool usePerfCounters{ false };
+
+	// golden image and frame time gate instead of a normal run, headless
+	bool isRegressionTest{ false };
+	RegressionTestOptions regressionTest{};
+};
+
+void PrintUsage()
+{
+	std::cout << "Usage: Rasterizer [--headless] [--width W] [--height H] [--scene quad|quadfield|vehicle|tuktuk]\n"
+		<< "                  [--frames N] [--camera-path static|orbit|<file>] [--output image.bmp] [--trace trace.json]\n"
+		<< "                  [--frame-times frame_times.csv] [--perf-counters] [--record camera_path.txt]\n"
+		<< "       Rasterizer --regression-test [--update-golden] [--golden-dir dir] [--min-psnr dB] [--max-pixel-diff N]\n"
+		<< "                  [--perf-tolerance fraction (negative to skip)]\n"
+		<< "--headless renders N frames into memory without opening a window and prints the timings" << std::endl;
+}
+
+bool ParseCommandLine(int argc, char* args[], CommandLineOptions& options)
+{
+	for (int argIdx{ 1 }; argIdx < argc; ++argIdx)
+	{
+		const std::string option{ args[argIdx] };
+		if (option == "--headless")
+		{
+			options.isHeadless = true;
+			continue;
+		}
+		if (option == "--perf-counters")
+		{
+			options.usePerfCounters = true;
+			continue;
+		}
+		if (option == "--regression-test")
+		{
+			options.isRegressionTest = true;
+			continue;
+		}
+		if (option == "--update-golden")
+		{
+			options.regressionTest.updateReferences = true;
+			continue;
+		}
+
+		// everything else takes a value
+		if (argIdx + 1 >= argc)
+			return false;
+		const std::string value{ args[++argIdx] };
+
+		if (option == "--width")
+			options.width = std::atoi(value.c_str());
+		else if (option == "--height")
+			options.height = std::atoi(value.c_str());
+		else if (option == "--frames")
+			options.nrFrames = std::atoi(value.c_str());
+		else if (option == "--scene")
+		{
+			if (!TryParseSceneType(value, options.scene))
+				return false;
+		}
+		else if (option == "--camera-path")
+			options.cameraPath = value;
+		else if (option == "--record")
+			options.recordPath = value;
+		else if (option == "--golden-dir")
+			options.regressionTest.directory = value;
+		else if (option == "--min-psnr")
+			options.regressionTest.minPsnr = static_cast<float>(std::atof(value.c_str()));
+		else if (option == "--max-pixel-diff")
+			options.regressionTest.maxPixelDiff = std::atoi(value.c_str());
+		else if (option == "--perf-tolerance")
+			options.regressionTest.maxSlowdown = static_cast<float>(std::atof(value.c_str()));
+		else if (option == "--output")
+			options.outputPath = value;
+		else if (option == "--trace")
+			options.tracePath = value;
+		else if (option == "--frame-times")
+			options.frameTimesPath = value;
+		else
+			return false;
+	}
+
+	return options.width > 0 && options.height > 0 && options.nrFrames > 0;
+}
+
+void WriteTrace(const CommandLineOptions& options)
+{
+	if (options.tracePath.empty())
+		return;
+
+	if (!Profiler::IsEnabled())
+		std::cout << "Built without ENABLE_PROFILING (use the Profile configuration), no trace written" << std::endl;
+	else if (Profiler::ExportChromeTrace(options.tracePath))
+		std::cout << "Trace saved to " << options.tracePath << std::endl;
+	else
+		std::cout << "Couldn't write the trace to " << options.tracePath << std::endl;
+}
+
+void EnablePerfCounters(const CommandLineOptions& options)
+{
+	if (!options.usePerfCounters)
+		return;
+
+	std::string reason{};
+	if (!Profiler::IsEnabled())
+		std::cout << "Built without ENABLE_PROFILING (use the Profile configuration), no per stage counters" << std::endl;
+	else if (!PerfCounters::IsAvailable(&reason))
+		std::cout << "Hardware counters unavailable (" << reason << "), timings only" << std::endl;
+	else
+		Profiler::SetCountersEnabled(true);
+}
+
+// Inclusive time per profiling marker, with the hardware counters when they were read for every call
+void PrintStageSummaries()
+{
+	if (!Profiler::IsEnabled())
+		return;
+
+	std::cout << "Stages:" << std::endl;
+	for (const ProfileStageSummary& stage : Profiler::GetStageSummaries())
+	{
+		std::cout << "  " << stage.name << ": " << stage.nrCalls << " calls / " << stage.totalMs << " ms total / "
+			<< stage.totalMs / stage.nrCalls << " ms avg";
+
+		if (stage.hasCounters)
+		{
+			const PerfCounterValues& counters{ stage.counters };
+			const double instructions{ static_cast<double>(counters.Get(PerfCounter::Instructions)) };
+
+			std::cout << " | IPC: " << instructions / std::max(static_cast<double>(counters.Get(PerfCounter::Cycles)), 1.0);
+			for (const PerfCounter counter : { PerfCounter::L1DataMisses, PerfCounter::LastLevelCacheMisses, PerfCounter::BranchMisses })
+			{
+				std::cout << " / " << PerfCounters::GetName(counter) << ": ";
+				if (PerfCounters::IsSupported(counter))
+					std::cout << counters.Get(counter) << " (" << 1000.0 * static_cast<double>(counters.Get(counter)) / std::max(instructions, 1.0) << " per 1k instr)";
+				else
+					std::cout << "n/a";
+			}
+		}
+		std::cout << std::endl;
+	}
+}
+
+void PrintFrameTimes(const char* pLabel, const FrameTimeStats::Summary& summary)
+{
+	std::cout << pLabel << " (" << summary.nrFrames << " frames) min: " << summary.min << " / avg: " << summary.avg
+		<< " / p50: " << summary.p50 << " / p95: " << summary.p95 << " / p99: " << summary.p99 << " / max: " << summary.max << " ms" << std::endl;
+}
+
+void WriteFrameTimes(const CommandLineOptions& options, const FrameTimeStats& frameTimeStats)
+{
+	if (options.frameTimesPath.empty())
+		return;
+
+	if (frameTimeStats.WriteCsv(options.frameTimesPath))
+		std::cout << "Frame times saved to " << options.frameTimesPath << std::endl;
+	else
+		std::cout << "Couldn't write the frame times to " << options.frameTimesPath << std::endl;
+}
+
+// Camera paths are sampled at a fixed rate, so a run renders the same frames however fast it goes
+constexpr float ReplayFrameTime{ 1.f / 60.f };
+
+bool CreateCameraPath(const CommandLineOptions& options, const Camera& camera, CameraPath& cameraPath)
+{
+	if (options.cameraPath == "static")
+		cameraPath = CameraPath::CreateStatic(camera.origin, camera.totalPitch, camera.totalYaw);
+	else if (options.cameraPath == "orbit")
+		cameraPath = CameraPath::CreateOrbit(camera.origin + camera.forward * 30.f, 30.f, 0.f, options.nrFrames * ReplayFrameTime);
+	else if (!cameraPath.LoadFromFile(options.cameraPath))
+	{
+		std::cout << "Couldn't load camera path " << options.cameraPath << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int RunHeadless(const CommandLineOptions& options)
+{
+	EnablePerfCounters(options);
+
+	const auto pRenderer = new Renderer(options.width, options.height, options.scene);
+	Camera& camera{ pRenderer->GetCamera() };
+
+	CameraPath cameraPath{};
+	if (!CreateCameraPath(options, camera, cameraPath))
+	{
+		delete pRenderer;
+		return 1;
+	}
+
+	std::cout << "Rendering " << options.nrFrames << " frames of " << GetSceneName(options.scene) << " at "
+		<< options.width << "x" << options.height << " (headless)" << std::endl;
+
+	const uint64_t startTime{ SDL_GetPerformanceCounter() };
+	uint64_t shadedPixels{};
+	FrameTimeStats frameTimeStats{ static_cast<uint32_t>(options.nrFrames) };
+
+	for (int frameIdx{}; frameIdx < options.nrFrames; ++frameIdx)
+	{
+		const uint64_t frameStartTime{ SDL_GetPerformanceCounter() };
+
+		const CameraKey key{ cameraPath.Sample(frameIdx * ReplayFrameTime) };
+		camera.SetPose(key.origin, key.pitch, key.yaw);
+
+		pRenderer->Render();
+		frameTimeStats.AddFrame(static_cast<float>(SDL_GetPerformanceCounter() - frameStartTime) / static_cast<float>(SDL_GetPerformanceFrequency()));
+
+		shadedPixels += pRenderer->GetFrameStats().shadedPixels;
+	}
+
+	const float totalSeconds{ static_cast<float>(SDL_GetPerformanceCounter() - startTime) / static_cast<float>(SDL_GetPerformanceFrequency()) };
+	std::cout << "total: " << totalSeconds << " s / " << totalSeconds * 1000.f / options.nrFrames << " ms per frame / "
+		<< options.nrFrames / totalSeconds << " fps" << std::endl;
+	std::cout << "shaded pixels per frame: " << shadedPixels / options.nrFrames << std::endl;
+	// the window holds every frame of the run, so these are exact
+	PrintFrameTimes("frame times", frameTimeStats.GetWindowSummary());
+
+	int result{ 0 };
+	if (!options.outputPath.empty())
+	{
+		if (!pRenderer->SaveBufferToImage(options.outputPath.c_str()))
+			std::cout << "Last frame saved to " << options.outputPath << std::endl;
+		else
+		{
+			std::cout << "Something went wrong. Last frame not saved!" << std::endl;
+			result = 1;
+		}
+	}
+
+	PrintStageSummaries();
+	WriteTrace(options);
+	WriteFrameTimes(options, frameTimeStats);
+
+	delete pRenderer;
+	return result;
+}
+
 void ShutDown(SDL_Window* pWindow)
 {
 	SDL_DestroyWindow(pWindow);
@@ -21,15 +288,24 @@ void ShutDown(SDL_Window* pWindow)
 
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	CommandLineOptions options{};
+	if (!ParseCommandLine(argc, args, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	// no SDL video at all, this is what runs on machines without a display
+	if (options.isRegressionTest)
+		return RunRegressionTest(options.regressionTest) == 0 ? 0 : 1;
+	if (options.isHeadless)
+		return RunHeadless(options);
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
 
-	const uint32_t width = 640;
-	const uint32_t height = 480;
+	const uint32_t width = options.width;
+	const uint32_t height = options.height;
 
 	SDL_Window* pWindow = SDL_CreateWindow(
 		"Rasterizer - Devon Brazelton",
@@ -40,9 +316,27 @@ int main(int argc, char* args[])
 	if (!pWindow)
 		return 1;
 
+	EnablePerfCounters(options);
+
 	//Initialize "framework"
 	const auto pTimer = new Timer();
-	const auto pRenderer = new Renderer(pWindow);
+	const auto pRenderer = new Renderer(pWindow, options.scene);
+	Camera& camera{ pRenderer->GetCamera() };
+
+	// replaying ignores the input and steps through the path at a fixed rate
+	const bool isReplaying{ options.cameraPath != "static" };
+	CameraPath replayPath{};
+	if (isReplaying && !CreateCameraPath(options, camera, replayPath))
+	{
+		delete pRenderer;
+		delete pTimer;
+		ShutDown(pWindow);
+		return 1;
+	}
+	int replayFrameIdx{};
+
+	CameraPath recordedPath{};
+	float recordTime{};
 
 	//Start loop
 	pTimer->Start();
@@ -65,23 +359,63 @@ int main(int argc, char* args[])
 					takeScreenshot = true;
 				else if (e.key.keysym.scancode == SDL_SCANCODE_F4)
 					pRenderer->SwitchVisualizationMethod();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F5)
+					pRenderer->SwitchDepthFormat();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F6)
+					pRenderer->SwitchRenderMode();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F7)
+					pRenderer->SwitchRasterKernels();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F8)
+					pRenderer->SwitchVertexFormat();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F9)
+					pRenderer->SwitchClusterCulling();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F10)
+					pRenderer->SwitchOcclusionCulling();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F11)
+					pRenderer->SwitchHierarchicalZ();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F12)
+					pRenderer->SwitchDrawSorting();
 				break;
 			}
 		}
 
 		//--------- Update ---------
-		pRenderer->Update(pTimer);
+		if (isReplaying)
+		{
+			const float replayTime{ replayFrameIdx * ReplayFrameTime };
+			if (replayTime > replayPath.GetDuration())
+				break;
+
+			const CameraKey key{ replayPath.Sample(replayTime) };
+			camera.SetPose(key.origin, key.pitch, key.yaw);
+			++replayFrameIdx;
+		}
+		else
+			pRenderer->Update(pTimer);
+
+		if (!options.recordPath.empty())
+			recordedPath.AddKey(CameraKey{ recordTime, camera.origin, camera.totalPitch, camera.totalYaw });
 
 		//--------- Render ---------
 		pRenderer->Render();
 
 		//--------- Timer ---------
 		pTimer->Update();
+		recordTime += pTimer->GetElapsed();
 		printTimer += pTimer->GetElapsed();
 		if (printTimer >= 1.f)
 		{
 			printTimer = 0.f;
 			std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+			PrintFrameTimes("frame times", pTimer->GetFrameTimeStats().GetWindowSummary());
+
+			const Renderer::FrameStats stats{ pRenderer->GetFrameStats() };
+			std::cout << "shaded pixels: " << stats.shadedPixels << " / covered pixels: " << pRenderer->CountCoveredPixels() << std::endl;
+			std::cout << "submitted triangles: " << stats.submittedTriangles << " / culled clusters: " << stats.culledClusters << std::endl;
+			std::cout << "occluded meshes: " << stats.occludedMeshes << " / occluded clusters: " << stats.occludedClusters
+				<< " / occlusion pass: " << stats.occlusionPassMs << " ms" << std::endl;
+			std::cout << "hierarchical z rejected blocks: " << stats.rejectedBlocks << std::endl;
+			std::cout << "frame arena: " << stats.frameArenaBytes << " bytes / high water mark: " << stats.frameArenaHighWaterMark << " bytes" << std::endl;
 		}
 
 		//Save screenshot after full render
@@ -96,6 +430,19 @@ int main(int argc, char* args[])
 	}
 	pTimer->Stop();
 
+	if (!options.recordPath.empty())
+	{
+		if (recordedPath.SaveToFile(options.recordPath))
+			std::cout << "Camera path of " << recordedPath.GetNrKeys() << " frames saved to " << options.recordPath << std::endl;
+		else
+			std::cout << "Couldn't write the camera path to " << options.recordPath << std::endl;
+	}
+
+	PrintStageSummaries();
+	WriteTrace(options);
+	PrintFrameTimes("session frame times", pTimer->GetFrameTimeStats().GetSessionSummary());
+	WriteFrameTimes(options, pTimer->GetFrameTimeStats());
+
 	//Shutdown "framework"
 	delete pRenderer;
 	delete pTimer;